@@ -0,0 +1,423 @@
+#include "MarchingSquares.h"
+#include "ThreadPool.h"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Benchmarks compute and compute_faster over a set of reference fields
+ *
+ * compute_faster runs twice, on MarchingSquares where the field is called
+ * through std::function, and as compute_faster_inlined on the engine built
+ * from the lambda's own type, where it is inlined into the sampling loop
+ *
+ * Every case is run a few times and the fastest run is reported, along
+ * with the cells and function evaluations per second, the peak heap
+ * usage and the number of allocations. A table goes to the console and
+ * the same numbers can be written as JSON to compare between builds:
+ *
+ *      benchmark [--quick] [--repetitions n] [--json file]
+ */
+
+namespace {
+
+// ----------------- Heap accounting -------------------------
+
+// Bytes in use, the peak since the last reset and the number of allocations
+std::atomic<size_t> heap_current{ 0 };
+std::atomic<size_t> heap_peak{ 0 };
+std::atomic<size_t> heap_allocations{ 0 };
+
+// Every block starts with its size, padded to keep the alignment of new
+constexpr size_t HeapHeader = alignof(std::max_align_t);
+
+void* CountedAllocate(const size_t size)
+{
+    auto* block = static_cast<char*>(std::malloc(size + HeapHeader));
+    if (!block)
+        throw std::bad_alloc();
+
+    *reinterpret_cast<size_t*>(block) = size;
+
+    const auto current = heap_current.fetch_add(size, std::memory_order_relaxed) + size;
+    heap_allocations.fetch_add(1, std::memory_order_relaxed);
+
+    auto peak = heap_peak.load(std::memory_order_relaxed);
+    while (current > peak && !heap_peak.compare_exchange_weak(peak, current, std::memory_order_relaxed))
+    {
+    }
+
+    return block + HeapHeader;
+}
+
+void CountedFree(void* pointer)
+{
+    if (!pointer)
+        return;
+
+    auto* block = static_cast<char*>(pointer) - HeapHeader;
+    heap_current.fetch_sub(*reinterpret_cast<size_t*>(block), std::memory_order_relaxed);
+
+    std::free(block);
+}
+
+void ResetHeapCounters()
+{
+    heap_peak = heap_current.load();
+    heap_allocations = 0;
+}
+
+} // namespace
+
+// The library's allocations go through these as well, on platforms that resolve
+// operator new globally. Peak memory is relative to the usage at the start of a run
+void* operator new(const size_t size)
+{
+    return CountedAllocate(size);
+}
+
+void* operator new[](const size_t size)
+{
+    return CountedAllocate(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+    CountedFree(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+    CountedFree(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+    CountedFree(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+    CountedFree(pointer);
+}
+
+namespace {
+
+using marching_squares::Function;
+using marching_squares::Limits;
+using marching_squares::Resolution;
+
+struct Result
+{
+    std::string field;
+    std::string method;
+    Resolution resolution;
+    size_t threads;
+
+    double seconds;
+    size_t evaluations;
+    size_t segments;
+    size_t peak_bytes;
+    size_t allocations;
+};
+
+struct Field;
+
+// Runs compute_faster_inlined for a field, see MakeField
+using InlinedRun = std::function<Result(const Field& field, const Resolution& resolution, size_t threads, size_t repetitions)>;
+
+struct Field
+{
+    std::string name;
+    Function function;
+    Limits x_limits;
+    Limits y_limits;
+    double iso_value;
+
+    // Larger grids take too long for the slow cases
+    size_t max_resolution;
+    size_t max_resolution_compute;
+
+    // Builds the engine from the lambda's own type instead of std::function
+    InlinedRun run_inlined;
+};
+
+template <typename Engine>
+Result Run(Engine& marching_squares, const Field& field, const Resolution& resolution, const std::string& method, size_t threads, size_t repetitions);
+
+/**
+ * Describes a reference field, keeping the type of its lambda for compute_faster_inlined
+ */
+template <typename F>
+Field MakeField(const std::string& name,
+                F function,
+                const Limits& x_limits,
+                const Limits& y_limits,
+                const double iso_value,
+                const size_t max_resolution,
+                const size_t max_resolution_compute)
+{
+    Field field{ name, function, x_limits, y_limits, iso_value, max_resolution, max_resolution_compute, nullptr };
+
+    field.run_inlined = [function](const Field& field, const Resolution& resolution, const size_t threads, const size_t repetitions)
+    {
+        auto marching_squares = marching_squares::MakeMarchingSquares(function, field.x_limits, field.y_limits, resolution);
+
+        return Run(marching_squares, field, resolution, "compute_faster_inlined", threads, repetitions);
+    };
+
+    return field;
+}
+
+std::vector<Field> ReferenceFields()
+{
+    return {
+        // Many long contours all over the domain
+        MakeField("dense", [](const double x, const double y) { return std::sin(x * x + y * y) - std::cos(x * y); },
+                  { -10, 10 }, { -10, 10 }, 0.5, 4096, 1024),
+
+        // A single circle, most cells are empty
+        MakeField("sparse", [](const double x, const double y) { return x * x + y * y; },
+                  { -10, 10 }, { -10, 10 }, 25, 4096, 1024),
+
+        // Saddles about every other cell, most crossed cells are case 5 or 10
+        MakeField("ambiguous", [](const double x, const double y) { return std::sin(1000 * x) * std::sin(1000 * y); },
+                  { -1, 1 }, { -1, 1 }, 0.01, 2048, 1024),
+
+        // Stands in for fields that are costly to evaluate
+        MakeField("expensive", [](const double x, const double y)
+                  {
+                      double value = 0;
+                      for (int k = 1; k <= 32; ++k)
+                          value += std::sin(k * x) * std::cos(k * y) / k;
+
+                      return value;
+                  },
+                  { -3, 3 }, { -3, 3 }, 0.1, 1024, 512),
+    };
+}
+
+/**
+ * Counts the function evaluations of one run of a method
+ *
+ * The strips of a threaded run sample their first column again, so the count depends on the threads
+ */
+size_t CountEvaluations(const Field& field, const Resolution& resolution, const std::string& method, const size_t threads)
+{
+    // Relaxed increments are fine, this run is not timed
+    auto counter = std::make_shared<std::atomic<size_t>>(0);
+    const auto function = field.function;
+    const Function counted = [counter, function](const double x, const double y)
+    {
+        counter->fetch_add(1, std::memory_order_relaxed);
+        return function(x, y);
+    };
+
+    marching_squares::MarchingSquares marching_squares(counted, field.x_limits, field.y_limits, resolution);
+    marching_squares.set_thread_count(threads);
+
+    if (method == "compute")
+        marching_squares.compute(field.iso_value);
+    else
+        marching_squares.compute_faster(field.iso_value);
+
+    return *counter;
+}
+
+/**
+ * Runs a method a number of times on an engine and keeps the fastest run
+ */
+template <typename Engine>
+Result Run(Engine& marching_squares, const Field& field, const Resolution& resolution, const std::string& method, const size_t threads, const size_t repetitions)
+{
+    marching_squares.set_thread_count(threads);
+
+    Result result{ field.name, method, resolution, threads, std::numeric_limits<double>::infinity(), 0, 0, 0, 0 };
+
+    for (size_t r = 0; r < repetitions; ++r)
+    {
+        ResetHeapCounters();
+        const auto heap_start = heap_current.load();
+        const auto start = std::chrono::steady_clock::now();
+
+        size_t segments;
+        if (method == "compute")
+            segments = marching_squares.compute(field.iso_value).size();
+        else
+            segments = std::get<1>(marching_squares.compute_faster(field.iso_value)).size();
+
+        const auto seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+        if (seconds < result.seconds)
+        {
+            result.seconds = seconds;
+            result.segments = segments;
+            result.peak_bytes = heap_peak.load() - heap_start;
+            result.allocations = heap_allocations.load();
+        }
+    }
+
+    result.evaluations = CountEvaluations(field, resolution, method, threads);
+
+    return result;
+}
+
+/**
+ * Runs a method on the engine calling the field through std::function
+ */
+Result Run(const Field& field, const Resolution& resolution, const std::string& method, const size_t threads, const size_t repetitions)
+{
+    auto marching_squares = marching_squares::MakeMarchingSquares(field.function, field.x_limits, field.y_limits, resolution);
+
+    return Run(marching_squares, field, resolution, method, threads, repetitions);
+}
+
+std::string ToJson(const std::vector<Result>& results)
+{
+    std::ostringstream json;
+    json << std::setprecision(9) << "{\n  \"benchmarks\": [\n";
+
+    for (size_t k = 0; k < results.size(); ++k)
+    {
+        const auto& result = results[k];
+        const auto cells = static_cast<double>(result.resolution[0] * result.resolution[1]);
+
+        json << "    {"
+             << "\"field\": \"" << result.field << "\", "
+             << "\"method\": \"" << result.method << "\", "
+             << "\"resolution\": [" << result.resolution[0] << ", " << result.resolution[1] << "], "
+             << "\"threads\": " << result.threads << ", "
+             << "\"seconds\": " << result.seconds << ", "
+             << "\"cells_per_second\": " << cells / result.seconds << ", "
+             << "\"evaluations\": " << result.evaluations << ", "
+             << "\"evaluations_per_second\": " << result.evaluations / result.seconds << ", "
+             << "\"segments\": " << result.segments << ", "
+             << "\"peak_bytes\": " << result.peak_bytes << ", "
+             << "\"allocations\": " << result.allocations
+             << "}" << (k + 1 < results.size() ? "," : "") << "\n";
+    }
+
+    json << "  ]\n}\n";
+
+    return json.str();
+}
+
+void PrintRow(const Result& result)
+{
+    const auto cells = static_cast<double>(result.resolution[0] * result.resolution[1]);
+
+    std::cout << std::left << std::setw(10) << result.field
+              << std::setw(24) << result.method
+              << std::right << std::setw(6) << result.resolution[0]
+              << std::setw(4) << result.threads
+              << std::fixed << std::setprecision(2)
+              << std::setw(11) << result.seconds * 1e3
+              << std::setw(11) << cells / result.seconds * 1e-6
+              << std::setw(11) << result.evaluations / result.seconds * 1e-6
+              << std::setw(11) << result.peak_bytes / (1024.0 * 1024.0)
+              << std::setw(9) << result.allocations
+              << std::setw(10) << result.segments << std::endl;
+}
+
+} // namespace
+
+int main(int argc, char* argv[])
+{
+    size_t repetitions = 3;
+    std::string json_path;
+    std::vector<size_t> resolutions = { 256, 1024, 4096 };
+
+    for (int k = 1; k < argc; ++k)
+    {
+        const std::string argument = argv[k];
+
+        if (argument == "--quick")
+        {
+            repetitions = 1;
+            resolutions = { 128, 512 };
+        }
+        else if (argument == "--repetitions" && k + 1 < argc)
+            repetitions = std::max(1, std::atoi(argv[++k]));
+        else if (argument == "--json" && k + 1 < argc)
+            json_path = argv[++k];
+        else
+        {
+            std::cerr << "Usage: " << argv[0] << " [--quick] [--repetitions n] [--json file]\n";
+            return 1;
+        }
+    }
+
+    const auto hardware_threads = marching_squares::ThreadPool::hardware_threads();
+
+    std::cout << std::left << std::setw(10) << "field"
+              << std::setw(24) << "method"
+              << std::right << std::setw(6) << "res"
+              << std::setw(4) << "thr"
+              << std::setw(11) << "ms"
+              << std::setw(11) << "Mcells/s"
+              << std::setw(11) << "Mevals/s"
+              << std::setw(11) << "peak MiB"
+              << std::setw(9) << "allocs"
+              << std::setw(10) << "segments" << std::endl;
+
+    std::vector<Result> results;
+
+    for (const auto& field : ReferenceFields())
+    {
+        for (const auto resolution : resolutions)
+        {
+            if (resolution > field.max_resolution)
+                continue;
+
+            const Resolution grid = { resolution, resolution };
+
+            if (resolution <= field.max_resolution_compute)
+            {
+                results.push_back(Run(field, grid, "compute", 1, repetitions));
+                PrintRow(results.back());
+            }
+
+            results.push_back(Run(field, grid, "compute_faster", 1, repetitions));
+            PrintRow(results.back());
+
+            results.push_back(field.run_inlined(field, grid, 1, repetitions));
+            PrintRow(results.back());
+
+            if (hardware_threads > 1)
+            {
+                results.push_back(Run(field, grid, "compute_faster", hardware_threads, repetitions));
+                PrintRow(results.back());
+
+                results.push_back(field.run_inlined(field, grid, hardware_threads, repetitions));
+                PrintRow(results.back());
+            }
+        }
+    }
+
+    if (!json_path.empty())
+    {
+        std::ofstream file(json_path);
+        file << ToJson(results);
+
+        if (!file)
+        {
+            std::cerr << "Could not write " << json_path << "\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,272 @@
+#pragma once
+
+// Internal includes
+#include "ThreadPool.h"
+
+// Standard includes
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+
+namespace marching_squares {
+
+// Thrown by ComputeJob::get when the job was cancelled
+class ComputeCancelled : public std::runtime_error
+{
+public:
+    ComputeCancelled(): std::runtime_error("The computation was cancelled") {}
+};
+
+/*
+ * Shared between a running computation and its job
+ *
+ * The sweep counts every major axis column it finishes and stops at the
+ * next column once a cancel is requested. Columns are swept by several
+ * strips at once, so they are not finished in order
+ */
+struct ComputeProgress
+{
+    std::atomic<bool> cancel_requested{ false };
+    std::atomic<size_t> columns_done{ 0 };
+    std::atomic<size_t> total_columns{ 0 };
+};
+
+template <typename T>
+class ComputeJob
+{
+/*
+ * A handle to a computation running on an executor, much like a std::future
+ *
+ * get waits for the result and moves it out, so it can be called once.
+ * It rethrows the exception of a failed computation, and throws
+ * ComputeCancelled if the job was cancelled before it finished
+ *
+ * Callbacks given to on_done run once the job is finished, cancelled or
+ * failed, on the thread that finished it, or right away if it already is.
+ * Copies of a job refer to the same computation
+ */
+
+public:
+    using Task = std::function<T(ComputeProgress& progress)>;
+
+    ComputeJob() = default;
+
+    static ComputeJob submit(ThreadPool& executor, Task task);
+
+    bool valid() const { return state_ != nullptr; }
+    bool ready() const;
+    bool cancelled() const;
+
+    void wait() const;
+    template <typename Rep, typename Period>
+    bool wait_for(const std::chrono::duration<Rep, Period>& timeout) const;
+
+    T get();
+
+    void cancel();
+    void on_done(std::function<void()> callback);
+
+    size_t columns_done() const;
+    size_t total_columns() const;
+    double progress() const;
+
+private:
+    enum class Status { Pending, Done, Cancelled, Failed };
+
+    struct State
+    {
+        std::mutex mutex;
+        std::condition_variable finished;
+        Status status = Status::Pending;
+
+        T result;
+        std::exception_ptr error;
+        bool retrieved = false;
+
+        ComputeProgress progress;
+        std::vector<std::function<void()>> callbacks;
+    };
+
+    std::shared_ptr<State> state_;
+
+    static void run(const std::shared_ptr<State>& state, const Task& task);
+};
+
+/**
+ * Starts a computation on the executor
+ *
+ * @param executor The pool to run the task on
+ * @param task The computation, it is given the progress to report to
+ * @return The job of the computation
+ */
+template <typename T>
+ComputeJob<T> ComputeJob<T>::submit(ThreadPool& executor, Task task)
+{
+    ComputeJob job;
+    job.state_ = std::make_shared<State>();
+
+    auto state = job.state_;
+    executor.submit([state, task]()
+    {
+        run(state, task);
+    });
+
+    return job;
+}
+
+template <typename T>
+void ComputeJob<T>::run(const std::shared_ptr<State>& state, const Task& task)
+{
+    auto status = Status::Done;
+    T result;
+    std::exception_ptr error;
+
+    // A job cancelled while it waited in the queue is not started at all
+    if (state->progress.cancel_requested.load())
+        status = Status::Cancelled;
+    else
+    {
+        try
+        {
+            result = task(state->progress);
+        }
+        catch (const ComputeCancelled&)
+        {
+            status = Status::Cancelled;
+        }
+        catch (...)
+        {
+            status = Status::Failed;
+            error = std::current_exception();
+        }
+    }
+
+    std::vector<std::function<void()>> callbacks;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        state->status = status;
+        state->result = std::move(result);
+        state->error = error;
+        callbacks.swap(state->callbacks);
+    }
+    state->finished.notify_all();
+
+    for (auto& callback : callbacks)
+        callback();
+}
+
+template <typename T>
+bool ComputeJob<T>::ready() const
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+
+    return state_->status != Status::Pending;
+}
+
+template <typename T>
+bool ComputeJob<T>::cancelled() const
+{
+    std::lock_guard<std::mutex> lock(state_->mutex);
+
+    return state_->status == Status::Cancelled;
+}
+
+template <typename T>
+void ComputeJob<T>::wait() const
+{
+    std::unique_lock<std::mutex> lock(state_->mutex);
+    state_->finished.wait(lock, [this]() { return state_->status != Status::Pending; });
+}
+
+/**
+ * Waits for the job to finish, at most for the given time
+ *
+ * @return true if the job is finished
+ */
+template <typename T>
+template <typename Rep, typename Period>
+bool ComputeJob<T>::wait_for(const std::chrono::duration<Rep, Period>& timeout) const
+{
+    std::unique_lock<std::mutex> lock(state_->mutex);
+
+    return state_->finished.wait_for(lock, timeout, [this]() { return state_->status != Status::Pending; });
+}
+
+template <typename T>
+T ComputeJob<T>::get()
+{
+    wait();
+
+    std::lock_guard<std::mutex> lock(state_->mutex);
+
+    if (state_->status == Status::Cancelled)
+        throw ComputeCancelled();
+    if (state_->status == Status::Failed)
+        std::rethrow_exception(state_->error);
+    if (state_->retrieved)
+        throw std::logic_error("ComputeJob::get: The result was already retrieved");
+
+    state_->retrieved = true;
+
+    return std::move(state_->result);
+}
+
+/**
+ * Asks the computation to stop, it does so at the next column
+ *
+ * A job that already finished keeps its result
+ */
+template <typename T>
+void ComputeJob<T>::cancel()
+{
+    state_->progress.cancel_requested = true;
+}
+
+template <typename T>
+void ComputeJob<T>::on_done(std::function<void()> callback)
+{
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+
+        if (state_->status == Status::Pending)
+        {
+            state_->callbacks.push_back(std::move(callback));
+            return;
+        }
+    }
+
+    callback();
+}
+
+template <typename T>
+size_t ComputeJob<T>::columns_done() const
+{
+    return state_->progress.columns_done.load(std::memory_order_relaxed);
+}
+
+template <typename T>
+size_t ComputeJob<T>::total_columns() const
+{
+    return state_->progress.total_columns.load(std::memory_order_relaxed);
+}
+
+/**
+ * @return The share of the columns swept so far, between 0 and 1
+ */
+template <typename T>
+double ComputeJob<T>::progress() const
+{
+    const auto total = total_columns();
+
+    return total > 0 ? static_cast<double>(columns_done()) / total : 0.0;
+}
+
+} // namespace marching_squares
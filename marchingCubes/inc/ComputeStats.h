@@ -0,0 +1,77 @@
+#pragma once
+
+// Standard includes
+#include <chrono>
+#include <cstddef>
+
+
+namespace marching_squares {
+
+/*
+ * Counters of a computation, to find out where the time goes
+ *
+ * The sampling and sweeping times are summed over all the threads, so with
+ * a thread pool they can add up to more than the wall time of the call.
+ * Bytes allocated and reallocations count the growth of the vertex and
+ * index buffers
+ *
+ * The counting is only compiled in with MARCHING_SQUARES_STATS defined,
+ * otherwise all the counters stay zero and cost nothing
+ */
+
+struct ComputeStats
+{
+    size_t node_evaluations = 0;
+    size_t crossing_edges = 0;
+    size_t ambiguous_cells = 0;
+
+    double sample_seconds = 0;
+    double sweep_seconds = 0;
+    double stitch_seconds = 0;
+
+    size_t bytes_allocated = 0;
+    size_t reallocations = 0;
+
+    ComputeStats& operator+=(const ComputeStats& other);
+};
+
+bool StatsEnabled();
+
+#ifdef MARCHING_SQUARES_STATS
+#define MARCHING_SQUARES_STAT(...) __VA_ARGS__
+#else
+#define MARCHING_SQUARES_STAT(...)
+#endif
+
+/**
+ * @param clock The start of the phase, set to now
+ *
+ * @return The seconds since the start of the phase
+ */
+inline double Lap(std::chrono::steady_clock::time_point& clock)
+{
+    const auto now = std::chrono::steady_clock::now();
+    const auto seconds = std::chrono::duration<double>(now - clock).count();
+    clock = now;
+
+    return seconds;
+}
+
+/**
+ * Counts a reallocation if the capacity of a buffer changed
+ *
+ * @param stats The stats to update
+ * @param old_capacity The capacity before
+ * @param new_capacity The capacity after
+ * @param element_size The size of an element in bytes
+ */
+inline void TrackGrowth(ComputeStats& stats, const size_t old_capacity, const size_t new_capacity, const size_t element_size)
+{
+    if (new_capacity == old_capacity)
+        return;
+
+    ++stats.reallocations;
+    stats.bytes_allocated += new_capacity * element_size;
+}
+
+} // namespace marching_squares
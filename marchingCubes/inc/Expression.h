@@ -0,0 +1,90 @@
+#pragma once
+
+// Standard includes
+#include <array>
+#include <cstddef>
+#include <string>
+#include <vector>
+
+
+namespace marching_squares {
+
+class Expression
+{
+/*
+ * A function of x and y given as text, compiled once to a small bytecode
+ *
+ * The syntax is the one of python and C arithmetic:
+ *
+ *      sin(x**2 + y**2) - cos(x*y)
+ *
+ * with the operators + - * / and ** (or ^) for powers, the names x, y,
+ * pi and e, numbers like 1, 0.5 or 2e-3 and the functions
+ *
+ *      sin cos tan asin acos atan sinh cosh tanh exp log log2 log10
+ *      sqrt cbrt abs floor ceil atan2(y, x) pow(a, b) min(a, b)
+ *      max(a, b) hypot(a, b)
+ *
+ * The bytecode runs on a stack of registers that hold a whole block of
+ * points each, every instruction is a tight loop over the block which the
+ * compiler vectorizes where it can. Constant subexpressions are folded
+ * while compiling, and an operation with a constant right operand takes
+ * it as an immediate instead of filling a register with it
+ *
+ * range runs the same bytecode with interval arithmetic and bounds the
+ * values over a whole rectangle. Every bound is rounded outwards by more
+ * than the error of the operation, so it holds the values the point
+ * evaluation computes, not only the exact ones. Operations that may give
+ * NaN, like the log of a negative interval, bound nothing
+ *
+ * Evaluating never changes the expression, so it can run on any number
+ * of threads at once. The registers and the interval stack live in
+ * scratch memory of the calling thread, sized for the deepest stack of a
+ * full block on first use, so repeated evaluations do not allocate
+ */
+
+public:
+    using Interval = std::array<double, 2>;
+
+    explicit Expression(const std::string& source);
+
+    const std::string& source() const;
+
+    double operator()(double x, double y) const;
+    void operator()(const double* xs, const double* ys, double* out, size_t count) const;
+
+    Interval range(const Interval& x_range, const Interval& y_range) const;
+
+private:
+    enum class OpCode;
+
+    struct Instruction
+    {
+        OpCode op;
+
+        // Binary operations take constant as their right operand instead of popping it
+        bool immediate;
+        double constant;
+    };
+
+    class Parser;
+
+    template <typename Visitor>
+    static auto visit_unary(OpCode op, Visitor&& visit);
+    template <typename Visitor>
+    static auto visit_binary(OpCode op, Visitor&& visit);
+
+    // Points evaluated at once, a register is a block of them
+    static constexpr size_t block_size_ = 256;
+
+    std::string source_;
+    std::vector<Instruction> code_;
+    size_t stack_depth_ = 0;
+
+    void run_block(const double* xs, const double* ys, double* out, size_t count, size_t stride, double* registers) const;
+
+    static Interval unary_range(OpCode op, const Interval& a);
+    static Interval binary_range(OpCode op, const Interval& a, const Interval& b);
+};
+
+} // namespace marching_squares
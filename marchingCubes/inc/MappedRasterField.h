@@ -0,0 +1,98 @@
+#pragma once
+
+// Internal includes
+#include "ScalarField.h"
+
+// Standard includes
+#include <cstdint>
+#include <string>
+
+
+namespace marching_squares {
+
+// The type of the values in a raster file
+enum class RasterType
+{
+    Float32,
+    Float64
+};
+
+class MappedRasterField final : public ScalarField
+{
+/*
+ * Reads the values from a raw binary raster file without loading it
+ *
+ * The file holds one row per y node and one column per x node, stored
+ * row after row in native byte order. It is either described by a header
+ * at the start of the file:
+ *
+ *      char[8]     magic "MSRASTER"
+ *      uint32_t    version, 1
+ *      uint32_t    bytes per value, 4 for float32 and 8 for float64
+ *      uint64_t    rows
+ *      uint64_t    columns
+ *
+ * or the type, dimensions and the offset of the first value are given
+ *
+ * The file is memory mapped and read with sequential access hints. The
+ * sweep walks the rows in file order, and the pages of the rows it has
+ * passed are given back, so a file larger than the memory is contoured
+ * with a working set of a few rows
+ */
+
+public:
+    explicit MappedRasterField(const std::string& path);
+
+    MappedRasterField(const std::string& path,
+                      RasterType type,
+                      size_t rows,
+                      size_t columns,
+                      size_t offset = 0);
+
+    ~MappedRasterField() override;
+
+    MappedRasterField(const MappedRasterField&) = delete;
+    MappedRasterField& operator=(const MappedRasterField&) = delete;
+
+    using ScalarField::sample_line;
+
+    double value(size_t ix, size_t iy) const override;
+    void sample_line(size_t ix, size_t iy, bool along_x, size_t count, double* out) const override;
+    MajorAxis preferred_major_axis() const override;
+
+    static void write_header(const std::string& path, RasterType type, size_t rows, size_t columns);
+
+    static constexpr size_t header_size = 32;
+
+private:
+    struct Layout
+    {
+        RasterType type;
+        size_t rows;
+        size_t columns;
+        size_t offset;
+    };
+
+    MappedRasterField(const std::string& path, const Layout& layout);
+
+    static Layout read_header(const std::string& path);
+
+    const RasterType type_;
+    const size_t columns_;
+    const size_t value_size_;
+
+    // The whole file is mapped, the values start at data_
+    const char* mapping_ = nullptr;
+    size_t mapping_size_ = 0;
+    const char* data_ = nullptr;
+
+#if defined(_WIN32)
+    void* file_ = nullptr;
+    void* file_mapping_ = nullptr;
+#endif
+
+    const char* row(size_t iy) const;
+    void release_rows_before(size_t iy) const;
+};
+
+} // namespace marching_squares
@@ -0,0 +1,83 @@
+#pragma once
+
+// Internal includes
+#include "ScalarVolume.h"
+#include "ThreadPool.h"
+
+// Standard includes
+#include <array>
+#include <cstdint>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+
+namespace marching_squares {
+
+using Point3D = std::array<double, 3>;
+using TriangleVertices = std::array<uint32_t, 3>;
+
+using VerticesList3D = std::vector<Point3D>;
+using TrianglesList = std::vector<TriangleVertices>;
+
+class MarchingCubes
+{
+/*
+ * Extracts the isosurface of a scalar volume as an indexed triangle mesh
+ *
+ * The volume is swept one layer of cubes at a time along z, keeping two
+ * slices of samples and the vertex indices of the edges of both slices,
+ * like compute_faster does with two columns. Every node is sampled once
+ * and every crossed edge gets one vertex, which all the cubes around the
+ * edge refer to
+ *
+ * Corner c of a cube lies at (c & 1, c >> 1 & 1, c >> 2 & 1), and bit c
+ * of the case is set if the value at the corner is above the iso value.
+ * The triangles of the 256 cases are derived when first needed: on every
+ * face of the cube, the crossings are paired so the corners above the
+ * iso value are kept apart, and the resulting loops are triangulated as
+ * fans. Neighbouring cubes see the same face the same way, so the surface
+ * has no holes. Triangles are counterclockwise seen from the side below
+ * the iso value
+ *
+ * With more than one thread, the z axis is split into slabs which are
+ * swept on the thread pool. The slices between slabs are sampled once
+ * up front, and the vertices on them are kept by the upper slab only.
+ * The result is the same for any number of threads
+ */
+
+public:
+    MarchingCubes(Function3D function,
+                  const Limits& x_limits,
+                  const Limits& y_limits,
+                  const Limits& z_limits,
+                  const Resolution3D& resolution);
+
+    MarchingCubes(std::shared_ptr<const ScalarVolume> volume,
+                  const Limits& x_limits,
+                  const Limits& y_limits,
+                  const Limits& z_limits);
+
+    std::tuple<VerticesList3D, TrianglesList> compute(double iso_value) const;
+
+    void set_thread_count(size_t thread_count);
+    size_t thread_count() const;
+
+private:
+    struct Slab;
+
+    static constexpr size_t slabs_per_thread_ = 4;
+
+    const std::shared_ptr<const ScalarVolume> volume_;
+    const Resolution3D resolution_;
+    const std::array<double, 3> lower_;
+    const std::array<double, 3> step_;
+
+    ThreadPoolHandle thread_pool_;
+
+    void emit_slice_vertices(Slab& slab, const double* values, size_t iz, double iso_value, uint32_t* x_edges, uint32_t* y_edges) const;
+    void emit_layer_vertices(Slab& slab, const double* lower, const double* upper, size_t iz, double iso_value, uint32_t* z_edges) const;
+    void sweep_slab(Slab& slab, double iso_value) const;
+};
+
+} // namespace marching_squares
@@ -1,10 +1,22 @@
 #pragma once
 
+// Internal includes
+#include "ScalarField.h"
+#include "ComputeJob.h"
+#include "ComputeStats.h"
+#include "PolylineAssembler.h"
+#include "VertexFormat.h"
+
 // Standard includes
 #include <vector>
 #include <array>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <memory>
+#include <string>
 #include <tuple>
+#include <utility>
 
 
 namespace marching_squares {
@@ -15,15 +27,204 @@ using EdgeVertices = std::array<uint32_t, 2>;
 using EdgeIndexList = std::vector<size_t>;
 
 using EdgeList = std::vector<std::array<std::array<double, 2>, 2>>;
-    
-using Function = std::function<double(double, double)>;
-using Limits = std::array<double, 2>;
-using Resolution = std::array<size_t, 2>;
 
 using VerticesList = std::vector<Point2D>;
 using IndicesList = std::vector<EdgeVertices>;
 
-class MarchingSquares
+// The most vertices one index buffer can address, the largest index value marks a missing vertex
+constexpr size_t MaxIndexedVertices = std::numeric_limits<uint32_t>::max();
+
+// Per level: the first vertex and the first index
+using OffsetTable = std::vector<std::array<size_t, 2>>;
+
+// How the indices of a streamed chunk are numbered
+enum class ChunkIndexing
+{
+    Global,     // Indices refer to all the vertices sent so far, every vertex is sent once
+    Local       // Indices refer to the vertices of the chunk, border vertices are sent twice
+};
+
+struct ContourChunk
+{
+    // The chunk covers the cells between these major axis nodes
+    size_t first_column = 0;
+    size_t last_column = 0;
+
+    // Global index of the first vertex of the chunk, 0 when streaming with local indexing.
+    // For compute_chunked, the index of the first vertex among the vertices of all the chunks
+    size_t vertex_offset = 0;
+
+    VerticesList vertices;
+    IndicesList indices;
+};
+
+using ChunkSink = std::function<void(ContourChunk& chunk)>;
+
+// Cells by their index iy * resolution[0] + ix, in increasing order
+using CellList = std::vector<uint64_t>;
+
+struct TrackedContour
+{
+    VerticesList vertices;
+    IndicesList indices;
+
+    // The cells the contour passes through, where the next step starts from
+    CellList active_cells;
+
+    // Whether the whole grid was swept instead of the band
+    bool full_sweep = false;
+
+    size_t node_evaluations = 0;
+};
+
+// Caller owned memory a contour is written into, capacities count elements
+struct OutputBuffers
+{
+    Point2D* vertices = nullptr;
+    size_t vertex_capacity = 0;
+
+    EdgeVertices* indices = nullptr;
+    size_t index_capacity = 0;
+};
+
+// The most vertices and indices a contour can have
+struct OutputBounds
+{
+    size_t vertices = 0;
+    size_t indices = 0;
+};
+
+struct OutputStatus
+{
+    // Written by this call, from the start of the buffers
+    size_t vertices_written = 0;
+    size_t indices_written = 0;
+
+    // Left for the next calls of write_remaining
+    size_t vertices_remaining = 0;
+    size_t indices_remaining = 0;
+
+    bool complete() const { return vertices_remaining == 0 && indices_remaining == 0; }
+};
+
+using ContourJob = ComputeJob<std::tuple<VerticesList, IndicesList>>;
+using LevelsJob = ComputeJob<std::tuple<VerticesList, IndicesList, OffsetTable>>;
+
+class EdgeListView
+{
+/*
+ * The segments of a contour as pairs of coordinates, expanded on access
+ *
+ * It holds the shared vertices and the indices of compute_faster, so a
+ * segment costs 8 bytes plus its share of the vertices instead of the 32
+ * bytes of an EdgeList entry. Segment k is built when it is read
+ */
+
+public:
+    using value_type = std::array<Point2D, 2>;
+
+    class const_iterator
+    {
+    public:
+        const_iterator(const EdgeListView* view, size_t index): view_(view), index_(index) {}
+
+        value_type operator*() const { return (*view_)[index_]; }
+        const_iterator& operator++() { ++index_; return *this; }
+        bool operator==(const const_iterator& other) const { return index_ == other.index_; }
+        bool operator!=(const const_iterator& other) const { return index_ != other.index_; }
+
+    private:
+        const EdgeListView* view_;
+        size_t index_;
+    };
+
+    EdgeListView() = default;
+    EdgeListView(VerticesList vertices, IndicesList indices);
+
+    size_t size() const;
+    bool empty() const;
+    value_type operator[](size_t index) const;
+
+    const_iterator begin() const;
+    const_iterator end() const;
+
+    const VerticesList& vertices() const;
+    const IndicesList& indices() const;
+
+    EdgeList to_edge_list() const;
+
+private:
+    VerticesList vertices_;
+    IndicesList indices_;
+};
+
+class Expression;
+class ThreadPool;
+
+class Workspace
+{
+/*
+ * The buffers used by a marching squares computation
+ *
+ * Passing the same workspace to repeated calls keeps the column buffers,
+ * index maps, coordinate scratch and the output vectors allocated, so
+ * after the first call compute_faster, compute_levels and compute_into
+ * request no more memory as long as the contours do not grow. This holds
+ * for every field source and any thread count: the thread pool reuses
+ * its task storage, and compiled expressions keep their registers in
+ * scratch memory of each thread, which a pool thread allocates the first
+ * time it samples one. Memory requested by the field itself, like a
+ * function that allocates, or by building the field cache is not covered
+ *
+ * The results stay in the workspace until the next call. A workspace
+ * must only be used by one call at a time, while a marching squares
+ * object can be shared by any number of threads with a workspace each
+ */
+
+public:
+    Workspace();
+    ~Workspace();
+
+    Workspace(Workspace&& other) noexcept;
+    Workspace& operator=(Workspace&& other) noexcept;
+
+    const VerticesList& vertices() const;
+    const IndicesList& indices() const;
+    const OffsetTable& offsets() const;
+    const ComputeStats& stats() const;
+
+private:
+    friend class MarchingSquaresBase;
+
+    struct StripLevel;
+    struct Strip;
+    struct ActiveTiles;
+
+    std::vector<Strip> strips_;
+
+    // Per level, the tiles of the cached field to sweep. When the field was
+    // culled instead, one more entry at the end holds the tiles to sample
+    std::vector<ActiveTiles> active_tiles_;
+
+    // The tiles culling kept with the bound of their values, and the blocks left to split
+    std::vector<std::pair<uint32_t, Limits>> bounded_tiles_;
+    std::vector<std::array<size_t, 4>> pending_blocks_;
+
+    // Offsets of every (level, strip) pair in the merged buffers
+    std::vector<std::array<size_t, 2>> part_offsets_;
+
+    // The vertices and indices already copied out, and whether the strips still hold the rest
+    std::array<size_t, 2> written_ = { 0, 0 };
+    bool output_pending_ = false;
+
+    VerticesList vertices_;
+    IndicesList indices_;
+    OffsetTable offsets_;
+
+    ComputeStats stats_;
+};
+
+class MarchingSquaresBase
 {
 /*
  * The standard approach in literature is to construct and use
@@ -60,18 +261,67 @@ class MarchingSquares
  *      id: 1000
  *
  * This binary converted to int corresponds to the lookup key
+ *
+ * The values at the nodes come from a ScalarField, which either
+ * evaluates a function or reads an already sampled array. A function
+ * can also be given as text, it is compiled to an Expression and
+ * evaluated a whole column at a time
+ *
+ * compute_levels samples every node once and scans it for all
+ * the requested iso values, compute_faster is its single level case.
+ * compute and compute_view are built on compute_faster as well, they
+ * only expand the indices to coordinate pairs
+ *
+ * compute_faster can split the major axis into strips which are
+ * swept on a thread pool. Neighbouring strips share their seam
+ * column, the vertices on it are only kept once while merging
+ *
+ * compute_streaming sweeps serially and hands the contour out in chunks
+ * of major axis columns, so it never has to be held in memory at once
+ *
+ * Vertex indices are 32 bits wide, so a single index buffer holds at most
+ * MaxIndexedVertices vertices. The calls returning one buffer throw a
+ * length_error beyond that. compute_chunked splits the contour into chunks
+ * of consecutive strips instead, each with its own vertices and indices.
+ * A chunk repeats the vertices on the column it shares with the previous
+ * chunk, so every chunk can be drawn on its own
+ *
+ * compute_adaptive only samples a coarse grid and refines the blocks
+ * the contour may pass through, then follows the contour cell by cell
+ *
+ * compute_tracked follows a contour that moves a little from one time
+ * step to the next. It only samples the cells around the active cells of
+ * the previous step and follows the contour from there, so its cost grows
+ * with the length of the contour instead of the area of the grid
+ *
+ * compute_into writes the contour into memory owned by the caller, like
+ * preallocated arrays or a mapped file. What does not fit stays in the
+ * workspace, and write_remaining continues with the next buffers, with
+ * indices counting from the first vertex of the whole contour. Together
+ * with a reused workspace nothing is allocated once the buffers are warm.
+ * estimate_output bounds the size without sampling the field
+ *
+ * With field caching enabled, the grid is sampled once and kept with
+ * the value range of every tile. Later calls read the cached values and
+ * only sweep the tiles whose range contains the iso value
+ *
+ * Without a cache, fields that bound their values over a block, like the
+ * ones compiled from an expression, are culled the same way before the
+ * sweep: blocks whose bound excludes the iso values are dropped, the others
+ * split until single tiles are left. Only the nodes of the remaining tiles
+ * are sampled, and the result is the same as sweeping the whole grid
+ *
+ * All the state of a computation lives in a Workspace, the object
+ * itself is not modified, so concurrent calls are safe
+ *
+ * compute_faster_async and compute_levels_async return right away with a
+ * job that runs the sweep on a shared executor. The job reports the major
+ * axis columns swept so far and can be cancelled between columns. The
+ * object has to outlive its jobs
  * 
  */
 
 private:
-    // Maps edge to node ids
-    const std::vector<EdgeVertices> edge_to_vertices_ = {
-        {0, 1},         // EdgeVertices 0
-        {1, 2},         // EdgeVertices 1
-        {2, 3},         // EdgeVertices 2
-        {3, 0}          // EdgeVertices 3
-    };
-    
     // Maps the case to intersected edges
     const std::vector<EdgeIndexList> lookup_table_ = {
         {},             // Case: 0,     0000
@@ -92,45 +342,217 @@ private:
         {}              // Case: 15     1111
     };
 
-    const size_t total_edges_ = edge_to_vertices_.size();
     const size_t total_cases_ = lookup_table_.size();
 
-    const Function function_;
+    const std::shared_ptr<const ScalarField> field_;
     const Limits x_limits_;
     const Limits y_limits_;
     const Resolution resolution_;
 
     const double dx_, dy_;
-    mutable double cur_x_, cur_y_;
     const bool x_major_;
 
     size_t nx1_, nx2_;
 
-    mutable uint32_t vertex_count_ = 0;
-    mutable VerticesList vertices_ = {};
+    // Strips handed out per thread, more strips balance the load better
+    static constexpr size_t strips_per_thread_ = 8;
+
+    ThreadPoolHandle thread_pool_;
+
+    // Cells per side of a tile of the cached field, one word of a node mask
+    static constexpr size_t tile_cells_ = 64;
+
+    struct FieldCache;
+
+    // Only accessed through std::atomic_load and std::atomic_store
+    std::shared_ptr<const FieldCache> field_cache_;
 
+    using StripLevel = Workspace::StripLevel;
+    using Strip = Workspace::Strip;
+
+    const EdgeIndexList& case_to_edges(size_t id) const;
+
+    Point2D node_point(size_t i, size_t j) const;
+    void sample_column(size_t i, std::vector<double>& column, LineScratch& scratch) const;
+    inline void check_vertical_edge(StripLevel& level, const double* arr, size_t i, uint32_t j, std::vector<uint32_t>& index_map) const;
+    inline void check_horizontal_edge(StripLevel& level, const Point2D&& values, size_t i, size_t j, uint32_t& index) const;
+    void sweep_column(StripLevel& level, const double* last_col_func, const double* cur_col_func, size_t i,
+                      const std::array<uint32_t, 2>* ranges, size_t range_count) const;
+    void seed_column(StripLevel& level, const double* column, size_t i) const;
+    const double* column_values(Strip& strip, size_t i, std::vector<double>& buffer) const;
+    void start_strip(Strip& strip) const;
+    void sweep_strip(Strip& strip) const;
+    void plan_output(Workspace& workspace) const;
+    std::array<size_t, 2> write_parts(Workspace& workspace, const OutputBuffers& buffers, ThreadPool* thread_pool) const;
+    template <typename Vertex, typename Convert>
+    std::array<size_t, 2> write_parts(Workspace& workspace, Vertex* vertices, size_t vertex_capacity, EdgeVertices* indices,
+                                      size_t index_capacity, const Convert& convert, ThreadPool* thread_pool) const;
+    template <typename Vertices, typename Convert>
+    std::tuple<Vertices, IndicesList> compute_faster_as(double iso_value, const Convert& convert) const;
+    void stitch_strips(Workspace& workspace, ThreadPool* thread_pool) const;
+    void sweep_strips(const double* iso_values, size_t level_count, Workspace& workspace,
+                      ThreadPool* thread_pool, ComputeProgress* progress, size_t max_strip_columns) const;
+    void sweep(const double* iso_values, size_t level_count, Workspace& workspace, ComputeProgress* progress = nullptr) const;
+    OutputStatus sweep_into(const double* iso_values, size_t level_count, Workspace& workspace, const OutputBuffers& buffers) const;
+    void gather_stats(Workspace& workspace, size_t vertex_count) const;
+    void build_chunk(const Workspace& workspace, size_t first_strip, size_t last_strip, ContourChunk& chunk) const;
+
+    std::shared_ptr<const FieldCache> build_field_cache(ThreadPool* thread_pool) const;
+    void select_tiles(const FieldCache& cache, double iso_value, Workspace::ActiveTiles& tiles) const;
+    void group_tiles(size_t major_tiles, size_t minor_tiles, Workspace::ActiveTiles& tiles) const;
+    bool cull_tiles(const double* iso_values, size_t level_count, Workspace& workspace) const;
+
+    struct AdaptiveState;
+
+    double adaptive_value(AdaptiveState& state, size_t i, size_t j) const;
+    uint32_t adaptive_vertex(AdaptiveState& state, size_t i, size_t j, bool along_major) const;
+    void refine_block(AdaptiveState& state, size_t i0, size_t i1, size_t j0, size_t j1) const;
+    void follow_cell(AdaptiveState& state, size_t i, size_t j) const;
+
+    MarchingSquaresBase(const Expression& expression,
+                        const Limits& x_limits,
+                        const Limits& y_limits,
+                        const Resolution& resolution);
+
+protected:
     static Resolution verify_resolution(const Resolution& resolution);
-    EdgeVertices edge_id_to_nodes(size_t id) const;
-    EdgeIndexList case_to_edges(size_t id) const;
-
-    void increment_minor_axis() const;
-    void reset_minor_axis() const;
-    void increment_major_axis() const;
-    void reset_major_axis() const;
-    inline void check_vertical_edge(std::vector<double>& arr, uint32_t index, double iso_value, Point2D& last_point, std::vector<uint32_t>& index_map) const;
-    Point2D get_previous_horizontal_point() const;
-    inline void check_horizontal_edge(const Point2D&& values, double iso_value, Point2D&& last_point, uint32_t& index) const;
-    void reset() const;
 
 public:
-    MarchingSquares(Function function,
-                    const Limits& x_limits,
-                    const Limits& y_limits,
-                    const Resolution& resolution);
+    MarchingSquaresBase(BatchFunction function,
+                        const Limits& x_limits,
+                        const Limits& y_limits,
+                        const Resolution& resolution);
+
+    MarchingSquaresBase(BatchFunction function,
+                        RangeFunction range,
+                        const Limits& x_limits,
+                        const Limits& y_limits,
+                        const Resolution& resolution);
+
+    MarchingSquaresBase(const std::string& expression,
+                        const Limits& x_limits,
+                        const Limits& y_limits,
+                        const Resolution& resolution);
+
+    MarchingSquaresBase(std::shared_ptr<const ScalarField> field,
+                        const Limits& x_limits,
+                        const Limits& y_limits);
+
+    MarchingSquaresBase(const double* values,
+                        size_t rows,
+                        size_t columns,
+                        std::ptrdiff_t row_stride,
+                        std::ptrdiff_t column_stride,
+                        const Limits& x_limits,
+                        const Limits& y_limits);
+
+    MarchingSquaresBase(const float* values,
+                        size_t rows,
+                        size_t columns,
+                        std::ptrdiff_t row_stride,
+                        std::ptrdiff_t column_stride,
+                        const Limits& x_limits,
+                        const Limits& y_limits);
     
     EdgeList compute(double iso_value) const;
+    EdgeListView compute_view(double iso_value) const;
 
     std::tuple<VerticesList, IndicesList> compute_faster(double iso_value) const;
+    void compute_faster(double iso_value, Workspace& workspace) const;
+
+    OutputBounds estimate_output(double iso_value) const;
+    OutputStatus compute_into(double iso_value, Workspace& workspace, const OutputBuffers& buffers) const;
+    OutputStatus compute_levels_into(const std::vector<double>& iso_values, Workspace& workspace, const OutputBuffers& buffers) const;
+    OutputStatus write_remaining(Workspace& workspace, const OutputBuffers& buffers) const;
+
+    std::tuple<VerticesListF, IndicesList> compute_faster_float(double iso_value) const;
+    std::tuple<QuantizedVerticesList, IndicesList> compute_faster_quantized(double iso_value) const;
+
+    void compute_streaming(double iso_value,
+                           size_t chunk_columns,
+                           const ChunkSink& sink,
+                           ChunkIndexing indexing = ChunkIndexing::Global) const;
+
+    std::vector<ContourChunk> compute_chunked(double iso_value, size_t max_chunk_vertices = MaxIndexedVertices) const;
+
+    std::tuple<VerticesList, Polylines> compute_polylines(double iso_value) const;
+
+    std::tuple<VerticesList, IndicesList> compute_adaptive(double iso_value,
+                                                           size_t coarse_step,
+                                                           double tolerance = 0) const;
+
+    TrackedContour compute_tracked(double iso_value,
+                                   const CellList& previous_cells,
+                                   size_t band = 1,
+                                   double max_band_fraction = 0.25) const;
+    CellList active_cells(const VerticesList& vertices, const IndicesList& indices) const;
+
+    std::tuple<VerticesList, IndicesList, OffsetTable> compute_levels(const std::vector<double>& iso_values) const;
+    void compute_levels(const std::vector<double>& iso_values, Workspace& workspace) const;
+
+    ContourJob compute_faster_async(double iso_value) const;
+    LevelsJob compute_levels_async(std::vector<double> iso_values) const;
+
+    void set_thread_count(size_t thread_count);
+    size_t thread_count() const;
+
+    void set_field_caching(bool enabled);
+    bool field_caching() const;
 };
 
+template <typename F>
+class MarchingSquaresT : public MarchingSquaresBase
+{
+/*
+ * Marching squares for a function of type F
+ *
+ * For lambdas and functors the function is inlined into the loop that
+ * samples the grid columns, std::function calls can not be. The other
+ * sources of the base class are available as well
+ *
+ * MarchingSquares is the std::function instantiation. For any other
+ * type, MakeMarchingSquares deduces F
+ */
+
+public:
+    using MarchingSquaresBase::MarchingSquaresBase;
+
+    MarchingSquaresT(F function,
+                     const Limits& x_limits,
+                     const Limits& y_limits,
+                     const Resolution& resolution);
+};
+
+using MarchingSquares = MarchingSquaresT<Function>;
+
+/**
+ * Constructor of the marching squares class
+ *
+ * @param function The function for which marching squares needs to be generated
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ * @param resolution The number of cells in the x and y direction
+ */
+template <typename F>
+MarchingSquaresT<F>::MarchingSquaresT(F function,
+                                      const Limits& x_limits,
+                                      const Limits& y_limits,
+                                      const Resolution& resolution):
+    MarchingSquaresBase(std::make_shared<FunctionFieldT<F>>(std::move(function), x_limits, y_limits, verify_resolution(resolution)),
+                        x_limits,
+                        y_limits)
+{
+}
+
+template <typename F>
+MarchingSquaresT<F> MakeMarchingSquares(F function,
+                                        const Limits& x_limits,
+                                        const Limits& y_limits,
+                                        const Resolution& resolution)
+{
+    return MarchingSquaresT<F>(std::move(function), x_limits, y_limits, resolution);
+}
+
+extern template class MarchingSquaresT<Function>;
+
 } //namespace marching_squares
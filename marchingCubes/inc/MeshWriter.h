@@ -0,0 +1,102 @@
+#pragma once
+
+// Internal includes
+#include "MarchingSquares.h"
+
+// Standard includes
+#include <cstdio>
+#include <string>
+#include <tuple>
+#include <vector>
+
+
+namespace marching_squares {
+
+// The file formats of MeshWriter
+enum class MeshFormat
+{
+    Binary,     // The MSMESH2D format described in MeshWriter
+    Ply         // Binary PLY with a vertex and an edge element
+};
+
+// The type the vertex coordinates are stored as
+enum class MeshPrecision
+{
+    Float32,
+    Float64
+};
+
+class MeshWriter
+{
+/*
+ * Writes the vertices and edges of a contour to a binary file
+ *
+ * The binary format is self-describing, all values in native byte order:
+ *
+ *      char[8]     magic "MSMESH2D"
+ *      uint32_t    version, 1
+ *      uint32_t    bytes per coordinate, 4 for float32 and 8 for float64
+ *      uint64_t    vertex count
+ *      uint64_t    edge count
+ *      vertices    x and y of every vertex
+ *      edges       uint32_t index of both vertices of every edge
+ *
+ * The PLY format has a vertex element with x, y and z = 0, since most
+ * tools expect three coordinates, and an edge element with vertex1 and
+ * vertex2. The counts in its header are padded with zeros so they can be
+ * filled in once everything is written
+ *
+ * Parts of a contour are appended as they come, e.g. the chunks of
+ * compute_streaming. The vertices go to the file right away through a
+ * large buffer, the edges are kept in a temporary file and copied behind
+ * the vertices by finish, which also fills in the counts. Nothing is held
+ * in memory beyond the buffers, so contours larger than the memory can be
+ * written
+ */
+
+public:
+    MeshWriter(const std::string& path, MeshFormat format, MeshPrecision precision = MeshPrecision::Float64);
+    ~MeshWriter();
+
+    MeshWriter(const MeshWriter&) = delete;
+    MeshWriter& operator=(const MeshWriter&) = delete;
+
+    void append(const Point2D* vertices, size_t vertex_count, const EdgeVertices* indices, size_t index_count);
+    void append(const VerticesList& vertices, const IndicesList& indices);
+    void append(const ContourChunk& chunk, ChunkIndexing indexing);
+
+    void finish();
+
+    size_t vertex_count() const;
+    size_t edge_count() const;
+
+private:
+    const std::string path_;
+    const MeshFormat format_;
+    const MeshPrecision precision_;
+
+    std::FILE* file_ = nullptr;
+    std::FILE* edges_ = nullptr;
+
+    std::vector<char> buffer_;
+    std::vector<EdgeVertices> edge_buffer_;
+
+    size_t vertex_count_ = 0;
+    size_t edge_count_ = 0;
+
+    void write_header();
+    void write_vertices(const Point2D* vertices, size_t vertex_count);
+    void write_edges(const EdgeVertices* indices, size_t index_count, size_t base);
+    void flush_buffer();
+    void close();
+};
+
+void WriteMesh(const std::string& path,
+               const VerticesList& vertices,
+               const IndicesList& indices,
+               MeshFormat format,
+               MeshPrecision precision = MeshPrecision::Float64);
+
+std::tuple<VerticesList, IndicesList> ReadMesh(const std::string& path);
+
+} // namespace marching_squares
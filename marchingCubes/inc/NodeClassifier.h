@@ -0,0 +1,55 @@
+#pragma once
+
+// Standard includes
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#endif
+
+
+namespace marching_squares {
+
+/*
+ * Classification of the nodes of a column against the iso value
+ *
+ * Every node gets one bit in each of two masks: above is set if the value
+ * is greater than the iso value, below if it is smaller. Nodes equal to the
+ * iso value (or NaN) have neither bit set. Bit n of a mask is stored in word
+ * n / 64 at position n % 64
+ *
+ * The comparisons use AVX when the compiler targets it, SSE2 on other x86-64
+ * builds and plain scalar code everywhere else
+ */
+
+using NodeMask = std::vector<uint64_t>;
+
+size_t MaskWords(size_t count);
+
+void ClassifyNodes(const double* values, size_t count, double iso_value, uint64_t* above, uint64_t* below);
+
+inline uint64_t MaskBit(const NodeMask& mask, const size_t n)
+{
+    return (mask[n >> 6] >> (n & 63)) & 1;
+}
+
+/**
+ * @param word A non zero word
+ *
+ * @return The index of the lowest set bit
+ */
+inline unsigned CountTrailingZeros(const uint64_t word)
+{
+#if defined(_MSC_VER)
+    unsigned long index;
+    _BitScanForward64(&index, word);
+
+    return static_cast<unsigned>(index);
+#else
+    return static_cast<unsigned>(__builtin_ctzll(word));
+#endif
+}
+
+} // namespace marching_squares
@@ -0,0 +1,38 @@
+#pragma once
+
+// Standard includes
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <vector>
+
+
+namespace marching_squares {
+
+/*
+ * Chains the segments of a contour into polylines
+ *
+ * The segments refer to their vertices by index, the shared indices give
+ * the connectivity. Walks start at vertices that do not have exactly two
+ * segments, which gives the open polylines. The segments left over after
+ * that form closed loops
+ *
+ * The result is stored compressed: polyline p is made of the vertices
+ * indices[offsets[p]] to indices[offsets[p + 1] - 1]. A closed loop ends
+ * with its first vertex again, so it can be drawn as a line strip as is
+ */
+
+struct Polylines
+{
+    std::vector<uint32_t> indices;
+
+    // One entry per polyline plus the total, starts with 0
+    std::vector<size_t> offsets;
+
+    // 1 for closed loops, 0 for open polylines
+    std::vector<uint8_t> closed;
+};
+
+Polylines AssemblePolylines(const std::vector<std::array<uint32_t, 2>>& segments, size_t vertex_count);
+
+} // namespace marching_squares
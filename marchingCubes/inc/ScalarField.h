@@ -0,0 +1,262 @@
+#pragma once
+
+// Standard includes
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+#include <vector>
+
+
+namespace marching_squares {
+
+using Function = std::function<double(double, double)>;
+using BatchFunction = std::function<void(const double* xs, const double* ys, double* out, size_t count)>;
+using Limits = std::array<double, 2>;
+using Resolution = std::array<size_t, 2>;
+
+// Bounds the values of a function over the rectangle x_range by y_range
+using RangeFunction = std::function<Limits(const Limits& x_range, const Limits& y_range)>;
+
+// Coordinate buffers a field may use while sampling a line, the sweep keeps one per strip
+struct LineScratch
+{
+    std::vector<double> xs;
+    std::vector<double> ys;
+};
+
+// The axis a field is best read along, the sweep walks its major axis one line at a time
+enum class MajorAxis
+{
+    Any,
+    X,
+    Y
+};
+
+class ScalarField
+{
+/*
+ * Provides the values of a scalar field on the nodes of a regular grid
+ *
+ * The grid has resolution[0] cells in x and resolution[1] cells in y,
+ * so node (ix, iy) has ix in [0, resolution[0]] and iy in [0, resolution[1]]
+ *
+ * The marching squares sweep reads the field one line of nodes at a
+ * time, so sources can fetch a whole line at once instead of going
+ * node by node
+ *
+ * The sweep passes scratch buffers to sample_line, fields that need memory
+ * per line use them instead of allocating, so a reused workspace samples
+ * without allocations
+ *
+ * The sweep picks the axis with more cells as its major axis, unless the
+ * field prefers one. Sources stored line by line prefer the axis their
+ * lines follow each other along
+ *
+ * Fields that can bound their values over a block of nodes without
+ * sampling it override value_range. The sweep then skips the blocks
+ * whose range excludes the iso value
+ */
+
+public:
+    explicit ScalarField(const Resolution& resolution);
+    virtual ~ScalarField() = default;
+
+    const Resolution& resolution() const;
+
+    virtual double value(size_t ix, size_t iy) const = 0;
+    virtual void sample_line(size_t ix, size_t iy, bool along_x, size_t count, double* out) const;
+    virtual void sample_line(size_t ix, size_t iy, bool along_x, size_t count, double* out, LineScratch& scratch) const;
+    virtual MajorAxis preferred_major_axis() const;
+    virtual bool value_range(size_t ix0, size_t iy0, size_t ix1, size_t iy1, Limits& range) const;
+
+private:
+    const Resolution resolution_;
+};
+
+template <typename F>
+class FunctionFieldT final : public ScalarField
+{
+/*
+ * Evaluates a function at the node coordinates
+ *
+ * Node (ix, iy) lies at (x_lower + ix * dx, y_lower + iy * dy)
+ *
+ * The function type is a template parameter, so lambdas and functors
+ * are inlined into the sampling loop where the compiler can optimize
+ * across calls. FunctionField is the std::function instantiation
+ */
+
+public:
+    FunctionFieldT(F function,
+                   const Limits& x_limits,
+                   const Limits& y_limits,
+                   const Resolution& resolution);
+
+    using ScalarField::sample_line;
+
+    double value(size_t ix, size_t iy) const override;
+    void sample_line(size_t ix, size_t iy, bool along_x, size_t count, double* out) const override;
+
+private:
+    const F function_;
+    const double x_lower_, y_lower_;
+    const double dx_, dy_;
+};
+
+using FunctionField = FunctionFieldT<Function>;
+
+class BatchFunctionField final : public ScalarField
+{
+/*
+ * Evaluates a function that takes whole arrays of coordinates at once
+ *
+ * The function receives count x and y coordinates and writes count
+ * values to out. sample_line makes a single call per line of nodes,
+ * so vectorized functions run at full speed and calls into an
+ * interpreter are made once per column instead of once per node
+ *
+ * The coordinates are written to the scratch buffers of the caller,
+ * without them every line allocates its own
+ */
+
+public:
+    BatchFunctionField(BatchFunction function,
+                       const Limits& x_limits,
+                       const Limits& y_limits,
+                       const Resolution& resolution);
+
+    double value(size_t ix, size_t iy) const override;
+    void sample_line(size_t ix, size_t iy, bool along_x, size_t count, double* out) const override;
+    void sample_line(size_t ix, size_t iy, bool along_x, size_t count, double* out, LineScratch& scratch) const override;
+
+private:
+    const BatchFunction function_;
+    const double x_lower_, y_lower_;
+    const double dx_, dy_;
+};
+
+class BoundedField final : public ScalarField
+{
+/*
+ * Adds a bound on the values over any rectangle to another field
+ *
+ * The range function receives the x and y intervals of a block of nodes
+ * and returns an interval holding every value the field takes at them,
+ * with node (ix, iy) at (x_lower + ix * dx, y_lower + iy * dy) like the
+ * function fields place it. Interval arithmetic, see Expression::range,
+ * or a Lipschitz bound, see LipschitzRange, provide one
+ *
+ * The bound is trusted. Blocks whose range excludes the iso value are
+ * skipped without sampling, so a range that is too narrow loses pieces of
+ * the contour, while a loose one only skips less
+ */
+
+public:
+    BoundedField(std::shared_ptr<const ScalarField> field,
+                 RangeFunction range,
+                 const Limits& x_limits,
+                 const Limits& y_limits);
+
+    double value(size_t ix, size_t iy) const override;
+    void sample_line(size_t ix, size_t iy, bool along_x, size_t count, double* out) const override;
+    void sample_line(size_t ix, size_t iy, bool along_x, size_t count, double* out, LineScratch& scratch) const override;
+    MajorAxis preferred_major_axis() const override;
+    bool value_range(size_t ix0, size_t iy0, size_t ix1, size_t iy1, Limits& range) const override;
+
+private:
+    const std::shared_ptr<const ScalarField> field_;
+    const RangeFunction range_;
+    const double x_lower_, y_lower_;
+    const double dx_, dy_;
+};
+
+RangeFunction LipschitzRange(Function function, double lipschitz);
+
+template <typename T>
+class StridedField final : public ScalarField
+{
+/*
+ * Reads the values from an already sampled 2D array without copying it
+ *
+ * The array has one row per y node and one column per x node, so
+ * node (ix, iy) is found at values[iy * row_stride + ix * column_stride].
+ * Strides are given in elements and may be negative
+ *
+ * The memory is not owned by the field. It must stay alive as long as
+ * the field is used, the optional owner is held on to for that purpose
+ */
+
+public:
+    StridedField(const T* values,
+                 size_t rows,
+                 size_t columns,
+                 std::ptrdiff_t row_stride,
+                 std::ptrdiff_t column_stride,
+                 std::shared_ptr<const void> owner = nullptr);
+
+    using ScalarField::sample_line;
+
+    double value(size_t ix, size_t iy) const override;
+    void sample_line(size_t ix, size_t iy, bool along_x, size_t count, double* out) const override;
+
+private:
+    const T* values_;
+    const std::ptrdiff_t row_stride_, column_stride_;
+    const std::shared_ptr<const void> owner_;
+
+    static Resolution shape_to_resolution(size_t rows, size_t columns);
+};
+
+/**
+ * Constructor of the function field
+ *
+ * @param function The function to evaluate at the nodes
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ * @param resolution The number of cells in the x and y direction
+ */
+template <typename F>
+FunctionFieldT<F>::FunctionFieldT(F function,
+                                  const Limits& x_limits,
+                                  const Limits& y_limits,
+                                  const Resolution& resolution):
+    ScalarField(resolution),
+    function_(std::move(function)),
+    x_lower_(x_limits[0]),
+    y_lower_(y_limits[0]),
+    dx_((x_limits[1] - x_limits[0]) / resolution[0]),
+    dy_((y_limits[1] - y_limits[0]) / resolution[1])
+{
+}
+
+template <typename F>
+double FunctionFieldT<F>::value(const size_t ix, const size_t iy) const
+{
+    return function_(x_lower_ + ix * dx_, y_lower_ + iy * dy_);
+}
+
+template <typename F>
+void FunctionFieldT<F>::sample_line(const size_t ix, const size_t iy, const bool along_x, const size_t count, double* out) const
+{
+    if (along_x)
+    {
+        const auto y = y_lower_ + iy * dy_;
+
+        for (size_t k = 0; k < count; ++k)
+            out[k] = function_(x_lower_ + (ix + k) * dx_, y);
+    }
+    else
+    {
+        const auto x = x_lower_ + ix * dx_;
+
+        for (size_t k = 0; k < count; ++k)
+            out[k] = function_(x, y_lower_ + (iy + k) * dy_);
+    }
+}
+
+extern template class FunctionFieldT<Function>;
+extern template class StridedField<double>;
+extern template class StridedField<float>;
+
+} // namespace marching_squares
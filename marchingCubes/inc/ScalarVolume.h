@@ -0,0 +1,106 @@
+#pragma once
+
+// Standard includes
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <memory>
+
+
+namespace marching_squares {
+
+using Function3D = std::function<double(double, double, double)>;
+using Limits = std::array<double, 2>;
+using Resolution3D = std::array<size_t, 3>;
+
+class ScalarVolume
+{
+/*
+ * Provides the values of a scalar field on the nodes of a regular 3D grid
+ *
+ * The grid has resolution[0] cells in x, resolution[1] in y and
+ * resolution[2] in z, so node (ix, iy, iz) has ix in [0, resolution[0]]
+ * and so on
+ *
+ * The marching cubes sweep reads the volume one z slice at a time.
+ * sample_slice fills the nodes of a slice row by row, one row per y
+ * node, so sources can fetch a whole slice at once
+ */
+
+public:
+    explicit ScalarVolume(const Resolution3D& resolution);
+    virtual ~ScalarVolume() = default;
+
+    const Resolution3D& resolution() const;
+
+    virtual double value(size_t ix, size_t iy, size_t iz) const = 0;
+    virtual void sample_slice(size_t iz, double* out) const;
+
+private:
+    const Resolution3D resolution_;
+};
+
+class FunctionVolume final : public ScalarVolume
+{
+/*
+ * Evaluates a function at the node coordinates
+ *
+ * Node (ix, iy, iz) lies at (x_lower + ix * dx, y_lower + iy * dy, z_lower + iz * dz)
+ */
+
+public:
+    FunctionVolume(Function3D function,
+                   const Limits& x_limits,
+                   const Limits& y_limits,
+                   const Limits& z_limits,
+                   const Resolution3D& resolution);
+
+    double value(size_t ix, size_t iy, size_t iz) const override;
+    void sample_slice(size_t iz, double* out) const override;
+
+private:
+    const Function3D function_;
+    const std::array<double, 3> lower_;
+    const std::array<double, 3> step_;
+};
+
+template <typename T>
+class StridedVolume final : public ScalarVolume
+{
+/*
+ * Reads the values from an already sampled 3D array without copying it
+ *
+ * The array has one slice per z node, one row per y node and one column
+ * per x node, so node (ix, iy, iz) is found at
+ * values[iz * slice_stride + iy * row_stride + ix * column_stride].
+ * Strides are given in elements and may be negative
+ *
+ * The memory is not owned by the volume. It must stay alive as long as
+ * the volume is used, the optional owner is held on to for that purpose
+ */
+
+public:
+    StridedVolume(const T* values,
+                  size_t slices,
+                  size_t rows,
+                  size_t columns,
+                  std::ptrdiff_t slice_stride,
+                  std::ptrdiff_t row_stride,
+                  std::ptrdiff_t column_stride,
+                  std::shared_ptr<const void> owner = nullptr);
+
+    double value(size_t ix, size_t iy, size_t iz) const override;
+    void sample_slice(size_t iz, double* out) const override;
+
+private:
+    const T* values_;
+    const std::ptrdiff_t slice_stride_, row_stride_, column_stride_;
+    const std::shared_ptr<const void> owner_;
+
+    static Resolution3D shape_to_resolution(size_t slices, size_t rows, size_t columns);
+};
+
+extern template class StridedVolume<double>;
+extern template class StridedVolume<float>;
+
+} // namespace marching_squares
@@ -0,0 +1,111 @@
+#pragma once
+
+// Standard includes
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+
+namespace marching_squares {
+
+class ThreadPool
+{
+/*
+ * A small work-stealing thread pool
+ *
+ * Every worker owns a queue of tasks. Submitted tasks are dealt out
+ * round robin over the queues, a worker pops from the front of its own
+ * queue and once it runs dry, it steals from the back of the others.
+ * This keeps all the workers busy even if the cost per task varies a
+ * lot, which is the case for strips with different contour density
+ *
+ * parallel_for blocks until all of its iterations are done. It submits
+ * one task per worker, and these and the calling thread claim iterations
+ * from a shared counter, so a pool with n workers runs n + 1 iterations
+ * at the same time. The body is called through a plain function pointer
+ * and the queues keep their capacity, so once they are warm, running a
+ * loop does not allocate
+ */
+
+public:
+    using Task = std::function<void()>;
+
+    explicit ThreadPool(size_t worker_count);
+    ~ThreadPool();
+
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    size_t size() const;
+
+    void submit(Task task);
+
+    template <typename Body>
+    void parallel_for(size_t count, const Body& body);
+
+    static size_t hardware_threads();
+
+private:
+    // A ring buffer of tasks, it only grows
+    struct WorkQueue
+    {
+        std::mutex mutex;
+        std::vector<Task> tasks;
+        size_t head = 0;
+        size_t size = 0;
+    };
+
+    std::vector<std::unique_ptr<WorkQueue>> queues_;
+    std::vector<std::thread> workers_;
+
+    std::atomic<size_t> next_queue_{ 0 };
+    std::atomic<size_t> pending_{ 0 };
+
+    std::mutex wake_mutex_;
+    std::condition_variable wake_;
+    bool stop_ = false;
+
+    bool try_pop(size_t queue_index, Task& task);
+    void worker_loop(size_t index);
+
+    void run_loop(size_t count, void (*body)(const void* context, size_t i), const void* context);
+};
+
+class ThreadPoolHandle
+{
+/*
+ * The thread pool of an object whose work runs on a configurable number of threads
+ *
+ * The calling thread takes part in the work, so n threads need a pool of
+ * n - 1 workers and a single thread needs none. The pool can be replaced
+ * while computations are running, they hold on to the one they started with
+ */
+
+public:
+    std::shared_ptr<ThreadPool> pool() const;
+
+    void set_thread_count(size_t thread_count);
+    size_t thread_count() const;
+
+private:
+    // Only accessed through std::atomic_load and std::atomic_store
+    std::shared_ptr<ThreadPool> pool_;
+};
+
+/**
+ * Runs body(i) for all i in [0, count) and waits for all of them to finish
+ *
+ * @param count The number of iterations
+ * @param body The function object to call for each iteration
+ */
+template <typename Body>
+void ThreadPool::parallel_for(const size_t count, const Body& body)
+{
+    run_loop(count, [](const void* context, const size_t i) { (*static_cast<const Body*>(context))(i); }, &body);
+}
+
+} // namespace marching_squares
@@ -0,0 +1,144 @@
+#pragma once
+
+// Internal includes
+#include "MarchingSquares.h"
+
+// Standard includes
+#include <array>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+
+namespace marching_squares {
+
+// Tile (x, y) of a level, for one iso value
+struct TileKey
+{
+    uint32_t level = 0;
+    int64_t x = 0;
+    int64_t y = 0;
+    double iso_value = 0;
+
+    bool operator==(const TileKey& other) const;
+};
+
+struct ContourTile
+{
+    TileKey key;
+    Limits x_limits;
+    Limits y_limits;
+
+    // The indices refer to the vertices of the tile
+    VerticesList vertices;
+    IndicesList indices;
+};
+
+class TiledContour
+{
+/*
+ * Contours a function over a pyramid of tiles, for viewers that pan and zoom
+ *
+ * Level 0 is a single tile covering the given limits. Every level splits
+ * the tiles of the one above in four, and every tile is contoured on a
+ * grid of tile_cells by tile_cells cells, so each level has twice the
+ * detail of the previous one. Tile indices are not bounded by the limits,
+ * the tiles go on in every direction with the same size
+ *
+ * tiles returns the tiles covering a rectangle at one level. The ones
+ * seen recently come from a cache bounded in bytes, the others are
+ * computed, in parallel with more than one thread, and then added to the
+ * cache while the least recently used ones are dropped. Panning thus only
+ * computes the tiles that come into view
+ *
+ * Tiles are contoured independently. Neighbouring tiles sample their
+ * shared border at the same coordinates, up to rounding of the node
+ * positions, so the pieces of a contour meet at the borders without
+ * being joined. The returned tiles stay valid after they leave the cache
+ *
+ * All the calls are safe to make from several threads
+ */
+
+public:
+    TiledContour(Function function,
+                 const Limits& x_limits,
+                 const Limits& y_limits,
+                 size_t tile_cells = 64,
+                 size_t cache_bytes = 64 << 20);
+
+    TiledContour(BatchFunction function,
+                 const Limits& x_limits,
+                 const Limits& y_limits,
+                 size_t tile_cells = 64,
+                 size_t cache_bytes = 64 << 20);
+
+    TiledContour(const std::string& expression,
+                 const Limits& x_limits,
+                 const Limits& y_limits,
+                 size_t tile_cells = 64,
+                 size_t cache_bytes = 64 << 20);
+
+    std::vector<std::shared_ptr<const ContourTile>> tiles(double iso_value,
+                                                          const Limits& x_view,
+                                                          const Limits& y_view,
+                                                          uint32_t level);
+
+    uint32_t level_for(const Limits& x_view, const Limits& y_view, const Resolution& pixels) const;
+
+    void set_cache_limit(size_t bytes);
+    size_t cache_limit() const;
+    size_t cached_bytes() const;
+    size_t cached_tiles() const;
+    size_t tiles_computed() const;
+    void clear_cache();
+
+    void set_thread_count(size_t thread_count);
+    size_t thread_count() const;
+
+private:
+    struct TileKeyHash
+    {
+        size_t operator()(const TileKey& key) const;
+    };
+
+    struct CacheEntry
+    {
+        std::shared_ptr<const ContourTile> tile;
+        size_t bytes;
+    };
+
+    using LruList = std::list<CacheEntry>;
+
+    // Deeper levels have tiles too small to tell apart from their neighbours in double precision
+    static constexpr uint32_t max_level_ = 40;
+
+    // Keeps a view at a fine level from asking for an unbounded number of tiles
+    static constexpr size_t max_tiles_per_request_ = 1 << 16;
+
+    const BatchFunction function_;
+    const Limits x_limits_;
+    const Limits y_limits_;
+    const size_t tile_cells_;
+
+    // Guards everything below, the tiles are computed without holding it
+    mutable std::mutex mutex_;
+
+    // Most recently used first
+    LruList lru_;
+    std::unordered_map<TileKey, LruList::iterator, TileKeyHash> index_;
+    size_t cache_limit_;
+    size_t cached_bytes_ = 0;
+    size_t tiles_computed_ = 0;
+
+    ThreadPoolHandle thread_pool_;
+
+    std::shared_ptr<const ContourTile> compute_tile(const TileKey& key) const;
+    void insert(std::shared_ptr<const ContourTile> tile);
+    void evict();
+};
+
+} // namespace marching_squares
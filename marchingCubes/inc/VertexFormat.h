@@ -0,0 +1,55 @@
+#pragma once
+
+// Standard includes
+#include <array>
+#include <cstdint>
+#include <vector>
+
+
+namespace marching_squares {
+
+/*
+ * Compact storage formats for the vertices of a contour
+ *
+ * The contour is always computed in double precision, the formats below are
+ * only used for the output. Float halves the size of the vertex buffer, the
+ * 16-bit quantized format quarters it: every coordinate is mapped linearly
+ * from its limits to [0, 65535], so the step is (upper - lower) / 65535
+ */
+
+using VerticesListF = std::vector<std::array<float, 2>>;
+using QuantizedVerticesList = std::vector<std::array<uint16_t, 2>>;
+
+constexpr double QuantizationSteps = 65535;
+
+/**
+ * Maps a coordinate to its quantized value
+ *
+ * @param value The coordinate
+ * @param lower The coordinate mapped to 0
+ * @param scale The number of steps per unit
+ */
+inline uint16_t Quantize(const double value, const double lower, const double scale)
+{
+    const auto steps = (value - lower) * scale;
+
+    // Also catches NaN
+    if (!(steps > 0))
+        return 0;
+    if (steps >= QuantizationSteps)
+        return static_cast<uint16_t>(QuantizationSteps);
+
+    return static_cast<uint16_t>(steps + 0.5);
+}
+
+VerticesListF ToFloatVertices(const std::vector<std::array<double, 2>>& vertices);
+
+QuantizedVerticesList QuantizeVertices(const std::vector<std::array<double, 2>>& vertices,
+                                       const std::array<double, 2>& x_limits,
+                                       const std::array<double, 2>& y_limits);
+
+std::vector<std::array<double, 2>> DequantizeVertices(const QuantizedVerticesList& vertices,
+                                                      const std::array<double, 2>& x_limits,
+                                                      const std::array<double, 2>& y_limits);
+
+} // namespace marching_squares
@@ -0,0 +1,34 @@
+// Internal Includes
+#include "ComputeStats.h"
+
+namespace marching_squares {
+
+ComputeStats& ComputeStats::operator+=(const ComputeStats& other)
+{
+    node_evaluations += other.node_evaluations;
+    crossing_edges += other.crossing_edges;
+    ambiguous_cells += other.ambiguous_cells;
+
+    sample_seconds += other.sample_seconds;
+    sweep_seconds += other.sweep_seconds;
+    stitch_seconds += other.stitch_seconds;
+
+    bytes_allocated += other.bytes_allocated;
+    reallocations += other.reallocations;
+
+    return *this;
+}
+
+/**
+ * @return Whether the library was built with the counters
+ */
+bool StatsEnabled()
+{
+#ifdef MARCHING_SQUARES_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+} // namespace marching_squares
@@ -0,0 +1,918 @@
+// Internal Includes
+#include "Expression.h"
+
+// Standard includes
+#include <algorithm>
+#include <cctype>
+#include <cmath>
+#include <cstring>
+#include <limits>
+#include <locale>
+#include <sstream>
+#include <stdexcept>
+#include <vector>
+
+namespace marching_squares {
+
+enum class Expression::OpCode
+{
+    // Push a register
+    LoadX,
+    LoadY,
+    Constant,
+
+    // Replace the top register
+    Negate,
+    Square,
+    Sin,
+    Cos,
+    Tan,
+    Asin,
+    Acos,
+    Atan,
+    Sinh,
+    Cosh,
+    Tanh,
+    Exp,
+    Log,
+    Log2,
+    Log10,
+    Sqrt,
+    Cbrt,
+    Abs,
+    Floor,
+    Ceil,
+
+    // Combine the two top registers into one, or the top one with the immediate
+    Add,
+    Subtract,
+    Multiply,
+    Divide,
+    Power,
+    Atan2,
+    Min,
+    Max,
+    Hypot
+};
+
+/**
+ * Calls visit with a function object computing a unary operation
+ *
+ * The same operation is applied to single values while folding constants
+ * and to whole registers while evaluating, so both see identical math
+ */
+template <typename Visitor>
+auto Expression::visit_unary(const OpCode op, Visitor&& visit)
+{
+    using Op = OpCode;
+
+    switch (op)
+    {
+    case Op::Square:    return visit([](const double a) { return a * a; });
+    case Op::Sin:       return visit([](const double a) { return std::sin(a); });
+    case Op::Cos:       return visit([](const double a) { return std::cos(a); });
+    case Op::Tan:       return visit([](const double a) { return std::tan(a); });
+    case Op::Asin:      return visit([](const double a) { return std::asin(a); });
+    case Op::Acos:      return visit([](const double a) { return std::acos(a); });
+    case Op::Atan:      return visit([](const double a) { return std::atan(a); });
+    case Op::Sinh:      return visit([](const double a) { return std::sinh(a); });
+    case Op::Cosh:      return visit([](const double a) { return std::cosh(a); });
+    case Op::Tanh:      return visit([](const double a) { return std::tanh(a); });
+    case Op::Exp:       return visit([](const double a) { return std::exp(a); });
+    case Op::Log:       return visit([](const double a) { return std::log(a); });
+    case Op::Log2:      return visit([](const double a) { return std::log2(a); });
+    case Op::Log10:     return visit([](const double a) { return std::log10(a); });
+    case Op::Sqrt:      return visit([](const double a) { return std::sqrt(a); });
+    case Op::Cbrt:      return visit([](const double a) { return std::cbrt(a); });
+    case Op::Abs:       return visit([](const double a) { return std::fabs(a); });
+    case Op::Floor:     return visit([](const double a) { return std::floor(a); });
+    case Op::Ceil:      return visit([](const double a) { return std::ceil(a); });
+    default:            return visit([](const double a) { return -a; });
+    }
+}
+
+/**
+ * Calls visit with a function object computing a binary operation
+ */
+template <typename Visitor>
+auto Expression::visit_binary(const OpCode op, Visitor&& visit)
+{
+    using Op = OpCode;
+
+    switch (op)
+    {
+    case Op::Subtract:  return visit([](const double a, const double b) { return a - b; });
+    case Op::Multiply:  return visit([](const double a, const double b) { return a * b; });
+    case Op::Divide:    return visit([](const double a, const double b) { return a / b; });
+    case Op::Power:     return visit([](const double a, const double b) { return std::pow(a, b); });
+    case Op::Atan2:     return visit([](const double a, const double b) { return std::atan2(a, b); });
+    case Op::Min:       return visit([](const double a, const double b) { return b < a ? b : a; });
+    case Op::Max:       return visit([](const double a, const double b) { return a < b ? b : a; });
+    case Op::Hypot:     return visit([](const double a, const double b) { return std::hypot(a, b); });
+    default:            return visit([](const double a, const double b) { return a + b; });
+    }
+}
+
+/*
+ * Interval arithmetic helpers. An interval with NaN bounds stands for one
+ * whose values may be NaN, it poisons everything computed from it
+ */
+
+static constexpr double Infinity = std::numeric_limits<double>::infinity();
+static constexpr double Pi = 3.14159265358979323846;
+
+// Rounding steps added to the bounds, correctly rounded operations are off by less than one
+static constexpr int ArithmeticUlps = 1;
+static constexpr int LibraryUlps = 8;
+
+/**
+ * Returns scratch memory of the calling thread with room for count elements
+ *
+ * The memory keeps its size between calls, it is only valid until the next
+ * call for the same type on the same thread
+ */
+template <typename T>
+static T* ThreadScratch(const size_t count)
+{
+    static thread_local std::vector<T> scratch;
+
+    if (scratch.size() < count)
+        scratch.resize(count);
+
+    return scratch.data();
+}
+
+static Expression::Interval Poison()
+{
+    return { std::numeric_limits<double>::quiet_NaN(), std::numeric_limits<double>::quiet_NaN() };
+}
+
+static bool IsFinite(const Expression::Interval& a)
+{
+    return std::isfinite(a[0]) && std::isfinite(a[1]);
+}
+
+static bool ContainsZero(const Expression::Interval& a)
+{
+    return a[0] <= 0 && a[1] >= 0;
+}
+
+/**
+ * Rounds the bounds of an interval outwards
+ *
+ * @param lower The lower bound
+ * @param upper The upper bound
+ * @param ulps The number of representable values to move each bound by
+ */
+static Expression::Interval Widen(double lower, double upper, const int ulps)
+{
+    if (std::isnan(lower) || std::isnan(upper))
+        return Poison();
+
+    for (int k = 0; k < ulps; ++k)
+    {
+        lower = std::nextafter(lower, -Infinity);
+        upper = std::nextafter(upper, Infinity);
+    }
+
+    return { lower, upper };
+}
+
+template <typename F>
+static Expression::Interval Increasing(const F& f, const Expression::Interval& a, const int ulps)
+{
+    return Widen(f(a[0]), f(a[1]), ulps);
+}
+
+template <typename F>
+static Expression::Interval Decreasing(const F& f, const Expression::Interval& a, const int ulps)
+{
+    return Widen(f(a[1]), f(a[0]), ulps);
+}
+
+/**
+ * @return The interval of the absolute values
+ */
+static Expression::Interval Magnitude(const Expression::Interval& a)
+{
+    if (a[0] >= 0)
+        return a;
+    if (a[1] <= 0)
+        return { -a[1], -a[0] };
+
+    return { 0, std::max(-a[0], a[1]) };
+}
+
+/**
+ * Bounds an even function that increases with the absolute value of its argument
+ */
+template <typename F>
+static Expression::Interval Even(const F& f, const Expression::Interval& a, const int ulps)
+{
+    return Increasing(f, Magnitude(a), ulps);
+}
+
+/**
+ * Whether point + k * period lies within the interval for some k, near misses count
+ */
+static bool ContainsPeriodic(const Expression::Interval& a, const double point, const double period)
+{
+    const auto tolerance = 1e-6;
+    const auto k = std::ceil((a[0] - point) / period - tolerance);
+
+    return point + k * period <= a[1] + tolerance * period;
+}
+
+/**
+ * Bounds sin or cos, which peak at peak + 2 k pi and bottom out half a period later
+ */
+template <typename F>
+static Expression::Interval Periodic(const F& f, const Expression::Interval& a, const double peak)
+{
+    // Far from 0 the period is lost in the rounding of the argument
+    if (a[1] - a[0] >= 2 * Pi || std::max(std::fabs(a[0]), std::fabs(a[1])) > 1e8)
+        return { -1, 1 };
+
+    auto range = Widen(std::min(f(a[0]), f(a[1])), std::max(f(a[0]), f(a[1])), LibraryUlps);
+
+    if (ContainsPeriodic(a, peak, 2 * Pi))
+        range[1] = 1;
+    if (ContainsPeriodic(a, peak + Pi, 2 * Pi))
+        range[0] = -1;
+
+    return range;
+}
+
+/**
+ * Bounds the values of a function over the corners of a rectangle, for functions without extremes inside it
+ */
+template <typename F>
+static Expression::Interval Corners(const F& f, const Expression::Interval& a, const Expression::Interval& b, const int ulps)
+{
+    const double values[] = { f(a[0], b[0]), f(a[0], b[1]), f(a[1], b[0]), f(a[1], b[1]) };
+
+    for (const auto value : values)
+        if (std::isnan(value))
+            return Poison();
+
+    return Widen(*std::min_element(std::begin(values), std::end(values)), *std::max_element(std::begin(values), std::end(values)), ulps);
+}
+
+/*
+ * Recursive descent parser emitting the bytecode in postfix order
+ *
+ * The precedence follows python: ** binds tighter than a unary minus on
+ * its left, so -x**2 is -(x**2), and it groups from the right
+ */
+class Expression::Parser
+{
+public:
+    Parser(const std::string& source, std::vector<Instruction>& code);
+
+    void parse();
+
+private:
+    const std::string& source_;
+    std::vector<Instruction>& code_;
+    size_t position_ = 0;
+
+    [[noreturn]] void fail(const std::string& message) const;
+
+    void skip_spaces();
+    bool accept(const char* token);
+    void expect(const char* token);
+
+    void parse_sum();
+    void parse_product();
+    void parse_unary();
+    void parse_power();
+    void parse_primary();
+    void parse_call(const std::string& name);
+
+    std::string parse_name();
+    double parse_number();
+
+    void emit_load(OpCode op, double constant = 0);
+    void emit_unary(OpCode op);
+    void emit_binary(OpCode op);
+};
+
+Expression::Parser::Parser(const std::string& source, std::vector<Instruction>& code):
+    source_(source),
+    code_(code)
+{
+}
+
+void Expression::Parser::parse()
+{
+    parse_sum();
+
+    skip_spaces();
+    if (position_ != source_.size())
+        fail("Unexpected '" + source_.substr(position_, 1) + "'");
+}
+
+void Expression::Parser::fail(const std::string& message) const
+{
+    throw std::invalid_argument("Expression::Constructor: " + message + " at position " + std::to_string(position_) + " of '" + source_ + "'");
+}
+
+void Expression::Parser::skip_spaces()
+{
+    while (position_ < source_.size() && std::isspace(static_cast<unsigned char>(source_[position_])))
+        ++position_;
+}
+
+/**
+ * Consumes the token if it comes next
+ *
+ * @return true if the token was found
+ */
+bool Expression::Parser::accept(const char* token)
+{
+    skip_spaces();
+
+    const auto length = std::strlen(token);
+    if (source_.compare(position_, length, token) != 0)
+        return false;
+
+    position_ += length;
+
+    return true;
+}
+
+void Expression::Parser::expect(const char* token)
+{
+    if (!accept(token))
+        fail("Expected '" + std::string(token) + "'");
+}
+
+void Expression::Parser::parse_sum()
+{
+    parse_product();
+
+    while (true)
+    {
+        if (accept("+"))
+        {
+            parse_product();
+            emit_binary(OpCode::Add);
+        }
+        else if (accept("-"))
+        {
+            parse_product();
+            emit_binary(OpCode::Subtract);
+        }
+        else
+            break;
+    }
+}
+
+void Expression::Parser::parse_product()
+{
+    parse_unary();
+
+    while (true)
+    {
+        if (accept("*"))
+        {
+            parse_unary();
+            emit_binary(OpCode::Multiply);
+        }
+        else if (accept("/"))
+        {
+            parse_unary();
+            emit_binary(OpCode::Divide);
+        }
+        else
+            break;
+    }
+}
+
+void Expression::Parser::parse_unary()
+{
+    if (accept("-"))
+    {
+        parse_unary();
+        emit_unary(OpCode::Negate);
+    }
+    else if (accept("+"))
+        parse_unary();
+    else
+        parse_power();
+}
+
+void Expression::Parser::parse_power()
+{
+    parse_primary();
+
+    // The exponent is parsed as a unary, which takes any further powers with it
+    if (accept("**") || accept("^"))
+    {
+        parse_unary();
+        emit_binary(OpCode::Power);
+    }
+}
+
+void Expression::Parser::parse_primary()
+{
+    skip_spaces();
+
+    if (position_ == source_.size())
+        fail("Expected a value");
+
+    const auto c = static_cast<unsigned char>(source_[position_]);
+
+    if (std::isdigit(c) || c == '.')
+        emit_load(OpCode::Constant, parse_number());
+    else if (std::isalpha(c) || c == '_')
+    {
+        const auto name = parse_name();
+
+        if (accept("("))
+            parse_call(name);
+        else if (name == "x")
+            emit_load(OpCode::LoadX);
+        else if (name == "y")
+            emit_load(OpCode::LoadY);
+        else if (name == "pi")
+            emit_load(OpCode::Constant, 3.14159265358979323846);
+        else if (name == "e")
+            emit_load(OpCode::Constant, 2.71828182845904523536);
+        else
+        {
+            position_ -= name.size();
+            fail("Unknown name '" + name + "'");
+        }
+    }
+    else if (accept("("))
+    {
+        parse_sum();
+        expect(")");
+    }
+    else
+        fail("Expected a value");
+}
+
+/**
+ * Parses the arguments of a function, the opening parenthesis is already consumed
+ *
+ * @param name The name of the function
+ */
+void Expression::Parser::parse_call(const std::string& name)
+{
+    struct Function
+    {
+        const char* name;
+        OpCode op;
+        size_t arity;
+    };
+
+    static const Function functions[] = {
+        { "sin", OpCode::Sin, 1 },      { "cos", OpCode::Cos, 1 },      { "tan", OpCode::Tan, 1 },
+        { "asin", OpCode::Asin, 1 },    { "acos", OpCode::Acos, 1 },    { "atan", OpCode::Atan, 1 },
+        { "sinh", OpCode::Sinh, 1 },    { "cosh", OpCode::Cosh, 1 },    { "tanh", OpCode::Tanh, 1 },
+        { "exp", OpCode::Exp, 1 },      { "log", OpCode::Log, 1 },      { "log2", OpCode::Log2, 1 },
+        { "log10", OpCode::Log10, 1 },  { "sqrt", OpCode::Sqrt, 1 },    { "cbrt", OpCode::Cbrt, 1 },
+        { "abs", OpCode::Abs, 1 },      { "floor", OpCode::Floor, 1 },  { "ceil", OpCode::Ceil, 1 },
+        { "atan2", OpCode::Atan2, 2 },  { "pow", OpCode::Power, 2 },    { "min", OpCode::Min, 2 },
+        { "max", OpCode::Max, 2 },      { "hypot", OpCode::Hypot, 2 }
+    };
+
+    const auto function = std::find_if(std::begin(functions), std::end(functions), [&name](const Function& f)
+    {
+        return name == f.name;
+    });
+
+    if (function == std::end(functions))
+    {
+        position_ -= name.size() + 1;
+        fail("Unknown function '" + name + "'");
+    }
+
+    size_t arguments = 0;
+    if (!accept(")"))
+    {
+        do
+        {
+            parse_sum();
+            ++arguments;
+        }
+        while (accept(","));
+
+        expect(")");
+    }
+
+    if (arguments != function->arity)
+        fail("'" + name + "' takes " + std::to_string(function->arity) + (function->arity == 1 ? " argument" : " arguments") +
+             ", not " + std::to_string(arguments));
+
+    if (function->arity == 1)
+        emit_unary(function->op);
+    else
+        emit_binary(function->op);
+}
+
+std::string Expression::Parser::parse_name()
+{
+    const auto first = position_;
+
+    while (position_ < source_.size() &&
+           (std::isalnum(static_cast<unsigned char>(source_[position_])) || source_[position_] == '_'))
+        ++position_;
+
+    return source_.substr(first, position_ - first);
+}
+
+double Expression::Parser::parse_number()
+{
+    const auto first = position_;
+    const auto digits = [this]()
+    {
+        while (position_ < source_.size() && std::isdigit(static_cast<unsigned char>(source_[position_])))
+            ++position_;
+    };
+
+    digits();
+    if (position_ < source_.size() && source_[position_] == '.')
+    {
+        ++position_;
+        digits();
+    }
+
+    // The exponent is only taken if digits follow, so 2e alone stays an error
+    if (position_ < source_.size() && (source_[position_] == 'e' || source_[position_] == 'E'))
+    {
+        auto exponent = position_ + 1;
+        if (exponent < source_.size() && (source_[exponent] == '+' || source_[exponent] == '-'))
+            ++exponent;
+
+        if (exponent < source_.size() && std::isdigit(static_cast<unsigned char>(source_[exponent])))
+        {
+            position_ = exponent;
+            digits();
+        }
+    }
+
+    // Parsed in the classic locale, the decimal separator is always a dot
+    std::istringstream stream(source_.substr(first, position_ - first));
+    stream.imbue(std::locale::classic());
+
+    double value = 0;
+    if (!(stream >> value) || stream.peek() != std::char_traits<char>::eof())
+    {
+        position_ = first;
+        fail("Invalid number");
+    }
+
+    return value;
+}
+
+void Expression::Parser::emit_load(const OpCode op, const double constant)
+{
+    code_.push_back({ op, false, constant });
+}
+
+void Expression::Parser::emit_unary(const OpCode op)
+{
+    if (code_.back().op == OpCode::Constant)
+    {
+        auto& value = code_.back().constant;
+        value = visit_unary(op, [value](const auto f) { return f(value); });
+    }
+    else
+        code_.push_back({ op, false, 0 });
+}
+
+/**
+ * Emits a binary operation, folding it or turning its right operand into an immediate
+ *
+ * In postfix order, a single instruction pushing a constant at the end of
+ * the code is the whole right operand. If the one before is a constant as
+ * well, it is the whole left operand
+ */
+void Expression::Parser::emit_binary(const OpCode op)
+{
+    if (code_.back().op != OpCode::Constant)
+    {
+        code_.push_back({ op, false, 0 });
+        return;
+    }
+
+    const auto right = code_.back().constant;
+    code_.pop_back();
+
+    if (code_.back().op == OpCode::Constant)
+    {
+        auto& left = code_.back().constant;
+        left = visit_binary(op, [left, right](const auto f) { return f(left, right); });
+    }
+    else if (op == OpCode::Power && right == 2)
+        code_.push_back({ OpCode::Square, false, 0 });
+    else
+        code_.push_back({ op, true, right });
+}
+
+/**
+ * Compiles an expression
+ *
+ * @param source The expression, a function of x and y
+ *
+ * @throws std::invalid_argument If the expression is not valid, the message tells where
+ */
+Expression::Expression(const std::string& source):
+    source_(source)
+{
+    Parser(source_, code_).parse();
+
+    size_t depth = 0;
+    for (const auto& instruction : code_)
+    {
+        if (instruction.op <= OpCode::Constant)
+            stack_depth_ = std::max(stack_depth_, ++depth);
+        else if (instruction.op >= OpCode::Add && !instruction.immediate)
+            --depth;
+    }
+}
+
+/**
+ * @return The text the expression was compiled from
+ */
+const std::string& Expression::source() const
+{
+    return source_;
+}
+
+/**
+ * Evaluates the expression at a single point
+ */
+double Expression::operator()(const double x, const double y) const
+{
+    double value = 0;
+    (*this)(&x, &y, &value, 1);
+
+    return value;
+}
+
+/**
+ * Evaluates the expression at many points, in blocks of block_size_
+ *
+ * Has the signature of a BatchFunction, so it can be used as one
+ *
+ * @param xs The x coordinates of the points
+ * @param ys The y coordinates of the points
+ * @param out Output, receives the values at the points
+ * @param count The number of points
+ */
+void Expression::operator()(const double* xs, const double* ys, double* out, const size_t count) const
+{
+    const auto stride = std::min(count, block_size_);
+
+    // Room for full blocks, so the scratch does not grow again for longer columns
+    const auto registers = ThreadScratch<double>(stack_depth_ * block_size_);
+
+    for (size_t first = 0; first < count; first += stride)
+        run_block(xs + first, ys + first, out + first, std::min(stride, count - first), stride, registers);
+}
+
+/**
+ * Bounds the values of the expression over a rectangle
+ *
+ * Every value the point evaluation computes within the rectangle lies in
+ * the returned interval. The interval is (-inf, inf) if NaN may come out
+ *
+ * @param x_range The lower and upper bounds in the x direction
+ * @param y_range The lower and upper bounds in the y direction
+ *
+ * @return The lower and upper bound of the values
+ */
+Expression::Interval Expression::range(const Interval& x_range, const Interval& y_range) const
+{
+    const auto stack = ThreadScratch<Interval>(stack_depth_);
+
+    // The number of intervals on the stack
+    size_t size = 0;
+
+    for (const auto& instruction : code_)
+    {
+        switch (instruction.op)
+        {
+        case OpCode::LoadX:
+            stack[size++] = x_range;
+            break;
+
+        case OpCode::LoadY:
+            stack[size++] = y_range;
+            break;
+
+        case OpCode::Constant:
+            stack[size++] = { instruction.constant, instruction.constant };
+            break;
+
+        default:
+            auto& top = stack[size - 1];
+
+            if (instruction.op < OpCode::Add)
+                top = unary_range(instruction.op, top);
+            else if (instruction.immediate)
+                top = binary_range(instruction.op, top, { instruction.constant, instruction.constant });
+            else
+            {
+                --size;
+                stack[size - 1] = binary_range(instruction.op, stack[size - 1], stack[size]);
+            }
+        }
+    }
+
+    const auto result = stack[size - 1];
+
+    if (std::isnan(result[0]) || std::isnan(result[1]))
+        return { -Infinity, Infinity };
+
+    return result;
+}
+
+/**
+ * Bounds a unary operation over an interval
+ *
+ * Arguments with infinite bounds may meet an operation that turns them
+ * into NaN, they are not followed any further
+ */
+Expression::Interval Expression::unary_range(const OpCode op, const Interval& a)
+{
+    using Op = OpCode;
+
+    if (!IsFinite(a))
+        return Poison();
+
+    const auto outside_unit = a[0] < -1 || a[1] > 1;
+
+    switch (op)
+    {
+    case Op::Negate:    return { -a[1], -a[0] };
+    case Op::Square:    return Even([](const double v) { return v * v; }, a, ArithmeticUlps);
+    case Op::Sin:       return Periodic([](const double v) { return std::sin(v); }, a, Pi / 2);
+    case Op::Cos:       return Periodic([](const double v) { return std::cos(v); }, a, 0);
+    case Op::Tan:
+        if (a[1] - a[0] >= Pi || std::max(std::fabs(a[0]), std::fabs(a[1])) > 1e8 || ContainsPeriodic(a, Pi / 2, Pi))
+            return Poison();
+        return Increasing([](const double v) { return std::tan(v); }, a, LibraryUlps);
+    case Op::Asin:      return outside_unit ? Poison() : Increasing([](const double v) { return std::asin(v); }, a, LibraryUlps);
+    case Op::Acos:      return outside_unit ? Poison() : Decreasing([](const double v) { return std::acos(v); }, a, LibraryUlps);
+    case Op::Atan:      return Increasing([](const double v) { return std::atan(v); }, a, LibraryUlps);
+    case Op::Sinh:      return Increasing([](const double v) { return std::sinh(v); }, a, LibraryUlps);
+    case Op::Cosh:      return Even([](const double v) { return std::cosh(v); }, a, LibraryUlps);
+    case Op::Tanh:      return Increasing([](const double v) { return std::tanh(v); }, a, LibraryUlps);
+    case Op::Exp:       return Increasing([](const double v) { return std::exp(v); }, a, LibraryUlps);
+    case Op::Log:       return a[0] < 0 ? Poison() : Increasing([](const double v) { return std::log(v); }, a, LibraryUlps);
+    case Op::Log2:      return a[0] < 0 ? Poison() : Increasing([](const double v) { return std::log2(v); }, a, LibraryUlps);
+    case Op::Log10:     return a[0] < 0 ? Poison() : Increasing([](const double v) { return std::log10(v); }, a, LibraryUlps);
+    case Op::Sqrt:      return a[0] < 0 ? Poison() : Increasing([](const double v) { return std::sqrt(v); }, a, ArithmeticUlps);
+    case Op::Cbrt:      return Increasing([](const double v) { return std::cbrt(v); }, a, LibraryUlps);
+    case Op::Abs:       return Magnitude(a);
+    case Op::Floor:     return Increasing([](const double v) { return std::floor(v); }, a, 0);
+    case Op::Ceil:      return Increasing([](const double v) { return std::ceil(v); }, a, 0);
+    default:            return Poison();
+    }
+}
+
+/**
+ * Bounds a binary operation over two intervals
+ */
+Expression::Interval Expression::binary_range(const OpCode op, const Interval& a, const Interval& b)
+{
+    using Op = OpCode;
+
+    if (!IsFinite(a) || !IsFinite(b))
+        return Poison();
+
+    switch (op)
+    {
+    case Op::Add:       return Widen(a[0] + b[0], a[1] + b[1], ArithmeticUlps);
+    case Op::Subtract:  return Widen(a[0] - b[1], a[1] - b[0], ArithmeticUlps);
+    case Op::Multiply:  return Corners([](const double u, const double v) { return u * v; }, a, b, ArithmeticUlps);
+    case Op::Divide:
+        if (ContainsZero(b))
+            return Poison();
+        return Corners([](const double u, const double v) { return u / v; }, a, b, ArithmeticUlps);
+    case Op::Min:       return { std::min(a[0], b[0]), std::min(a[1], b[1]) };
+    case Op::Max:       return { std::max(a[0], b[0]), std::max(a[1], b[1]) };
+    case Op::Hypot:
+    {
+        const auto u = Magnitude(a);
+        const auto v = Magnitude(b);
+
+        return Widen(std::hypot(u[0], v[0]), std::hypot(u[1], v[1]), LibraryUlps);
+    }
+    case Op::Atan2:
+        // Around the origin or across the cut along the negative x axis, any angle comes out
+        if (ContainsZero(a) && b[0] <= 0)
+            return Widen(-Pi, Pi, LibraryUlps);
+        return Corners([](const double u, const double v) { return std::atan2(u, v); }, a, b, LibraryUlps);
+    case Op::Power:
+    {
+        const auto power = [](const double u, const double v) { return std::pow(u, v); };
+        const auto n = b[0];
+
+        // An integer exponent is fine with negative bases, it is odd or even in them
+        if (b[0] == b[1] && n == std::floor(n) && std::fabs(n) < 9007199254740992.0)
+        {
+            const auto bound = [&power, n](const double u) { return power(u, n); };
+            const auto odd = std::fmod(n, 2) != 0;
+
+            if (n == 0)
+                return { 1, 1 };
+            if (n < 0 && ContainsZero(a))
+                return Poison();
+            if (odd)
+                return n > 0 ? Increasing(bound, a, LibraryUlps) : Decreasing(bound, a, LibraryUlps);
+
+            return n > 0 ? Increasing(bound, Magnitude(a), LibraryUlps) : Decreasing(bound, Magnitude(a), LibraryUlps);
+        }
+
+        // Otherwise pow is exp(b log(a)), bilinear in b and log(a), so its extremes are at the corners
+        if (a[0] < 0)
+            return Poison();
+
+        return Corners(power, a, b, LibraryUlps);
+    }
+    default:            return Poison();
+    }
+}
+
+/**
+ * Runs the bytecode over a block of points
+ *
+ * @param xs The x coordinates of the points
+ * @param ys The y coordinates of the points
+ * @param out Output, receives the values at the points
+ * @param count The number of points, at most stride
+ * @param stride The distance between two registers
+ * @param registers Room for stack_depth_ registers
+ */
+void Expression::run_block(const double* xs,
+                           const double* ys,
+                           double* out,
+                           const size_t count,
+                           const size_t stride,
+                           double* registers) const
+{
+    // The register on top of the stack, null while the stack is empty
+    double* top = nullptr;
+
+    for (const auto& instruction : code_)
+    {
+        switch (instruction.op)
+        {
+        case OpCode::LoadX:
+            top = top ? top + stride : registers;
+            std::copy(xs, xs + count, top);
+            break;
+
+        case OpCode::LoadY:
+            top = top ? top + stride : registers;
+            std::copy(ys, ys + count, top);
+            break;
+
+        case OpCode::Constant:
+            top = top ? top + stride : registers;
+            std::fill(top, top + count, instruction.constant);
+            break;
+
+        default:
+            if (instruction.op < OpCode::Add)
+            {
+                visit_unary(instruction.op, [top, count](const auto f)
+                {
+                    for (size_t k = 0; k < count; ++k)
+                        top[k] = f(top[k]);
+                });
+            }
+            else if (instruction.immediate)
+            {
+                const auto b = instruction.constant;
+
+                visit_binary(instruction.op, [top, b, count](const auto f)
+                {
+                    for (size_t k = 0; k < count; ++k)
+                        top[k] = f(top[k], b);
+                });
+            }
+            else
+            {
+                const auto* b = top;
+                top -= stride;
+
+                visit_binary(instruction.op, [top, b, count](const auto f)
+                {
+                    for (size_t k = 0; k < count; ++k)
+                        top[k] = f(top[k], b[k]);
+                });
+            }
+        }
+    }
+
+    std::copy(top, top + count, out);
+}
+
+} // namespace marching_squares
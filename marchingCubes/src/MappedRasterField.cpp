@@ -0,0 +1,314 @@
+// Internal Includes
+#include "MappedRasterField.h"
+
+// Standard includes
+#include <algorithm>
+#include <cstring>
+#include <fstream>
+#include <limits>
+#include <stdexcept>
+
+#if defined(_WIN32)
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace marching_squares {
+
+namespace {
+
+const char RasterMagic[8] = { 'M', 'S', 'R', 'A', 'S', 'T', 'E', 'R' };
+constexpr uint32_t RasterVersion = 1;
+
+size_t ValueSize(const RasterType type)
+{
+    return type == RasterType::Float32 ? sizeof(float) : sizeof(double);
+}
+
+size_t PageSize()
+{
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+
+    return info.dwAllocationGranularity;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+} // namespace
+
+/**
+ * Constructor of the raster field from a file with a header
+ *
+ * @param path The raster file
+ */
+MappedRasterField::MappedRasterField(const std::string& path):
+    MappedRasterField(path, read_header(path))
+{
+}
+
+/**
+ * Constructor of the raster field from a file without a header
+ *
+ * @param path The raster file
+ * @param type The type of the values
+ * @param rows The number of nodes in the y direction
+ * @param columns The number of nodes in the x direction
+ * @param offset The position of the first value in the file, in bytes
+ */
+MappedRasterField::MappedRasterField(const std::string& path,
+                                     const RasterType type,
+                                     const size_t rows,
+                                     const size_t columns,
+                                     const size_t offset):
+    MappedRasterField(path, Layout{ type, rows, columns, offset })
+{
+}
+
+MappedRasterField::MappedRasterField(const std::string& path, const Layout& layout):
+    ScalarField(layout.rows >= 2 && layout.columns >= 2 ? Resolution{ layout.columns - 1, layout.rows - 1 } : Resolution{ 0, 0 }),
+    type_(layout.type),
+    columns_(layout.columns),
+    value_size_(ValueSize(layout.type))
+{
+    if (layout.rows < 2 || layout.columns < 2)
+        throw std::invalid_argument("MappedRasterField::Constructor: The raster needs at least 2 rows and 2 columns");
+
+    // The dimensions may come from a header, their size must not wrap around
+    const auto max_size = std::numeric_limits<size_t>::max();
+
+    if (layout.columns > (max_size - layout.offset) / value_size_ / layout.rows)
+        throw std::invalid_argument("MappedRasterField::Constructor: The dimensions of " + path + " exceed the addressable size");
+
+    const auto required = layout.offset + layout.rows * layout.columns * value_size_;
+
+#if defined(_WIN32)
+    file_ = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file_ == INVALID_HANDLE_VALUE)
+        throw std::runtime_error("MappedRasterField::Constructor: Could not open " + path);
+
+    LARGE_INTEGER size;
+    if (!GetFileSizeEx(file_, &size))
+    {
+        CloseHandle(file_);
+        throw std::runtime_error("MappedRasterField::Constructor: Could not read the size of " + path);
+    }
+    mapping_size_ = static_cast<size_t>(size.QuadPart);
+
+    if (mapping_size_ < required)
+    {
+        CloseHandle(file_);
+        throw std::invalid_argument("MappedRasterField::Constructor: " + path + " is smaller than the given dimensions");
+    }
+
+    file_mapping_ = CreateFileMappingA(file_, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    mapping_ = file_mapping_ ? static_cast<const char*>(MapViewOfFile(file_mapping_, FILE_MAP_READ, 0, 0, 0)) : nullptr;
+
+    if (!mapping_)
+    {
+        if (file_mapping_)
+            CloseHandle(file_mapping_);
+        CloseHandle(file_);
+        throw std::runtime_error("MappedRasterField::Constructor: Could not map " + path);
+    }
+#else
+    const auto file = open(path.c_str(), O_RDONLY);
+    if (file < 0)
+        throw std::runtime_error("MappedRasterField::Constructor: Could not open " + path);
+
+    struct stat status;
+    if (fstat(file, &status) != 0)
+    {
+        close(file);
+        throw std::runtime_error("MappedRasterField::Constructor: Could not read the size of " + path);
+    }
+    mapping_size_ = static_cast<size_t>(status.st_size);
+
+    if (mapping_size_ < required)
+    {
+        close(file);
+        throw std::invalid_argument("MappedRasterField::Constructor: " + path + " is smaller than the given dimensions");
+    }
+
+    // The mapping stays valid after the file is closed
+    auto* mapping = mmap(nullptr, mapping_size_, PROT_READ, MAP_SHARED, file, 0);
+    close(file);
+
+    if (mapping == MAP_FAILED)
+        throw std::runtime_error("MappedRasterField::Constructor: Could not map " + path);
+
+    // Read ahead aggressively, the rows are read in file order
+    madvise(mapping, mapping_size_, MADV_SEQUENTIAL);
+    mapping_ = static_cast<const char*>(mapping);
+#endif
+
+    data_ = mapping_ + layout.offset;
+}
+
+MappedRasterField::~MappedRasterField()
+{
+#if defined(_WIN32)
+    UnmapViewOfFile(mapping_);
+    CloseHandle(file_mapping_);
+    CloseHandle(file_);
+#else
+    munmap(const_cast<char*>(mapping_), mapping_size_);
+#endif
+}
+
+/**
+ * Reads the layout from the header of a raster file
+ *
+ * @param path The raster file
+ */
+MappedRasterField::Layout MappedRasterField::read_header(const std::string& path)
+{
+    std::ifstream file(path, std::ios::binary);
+    if (!file)
+        throw std::runtime_error("MappedRasterField::read_header: Could not open " + path);
+
+    char magic[8];
+    uint32_t version, value_size;
+    uint64_t rows, columns;
+
+    file.read(magic, sizeof(magic));
+    file.read(reinterpret_cast<char*>(&version), sizeof(version));
+    file.read(reinterpret_cast<char*>(&value_size), sizeof(value_size));
+    file.read(reinterpret_cast<char*>(&rows), sizeof(rows));
+    file.read(reinterpret_cast<char*>(&columns), sizeof(columns));
+
+    if (!file || std::memcmp(magic, RasterMagic, sizeof(magic)) != 0)
+        throw std::invalid_argument("MappedRasterField::read_header: " + path + " has no raster header");
+    if (version != RasterVersion)
+        throw std::invalid_argument("MappedRasterField::read_header: Unsupported raster version in " + path);
+    if (value_size != sizeof(float) && value_size != sizeof(double))
+        throw std::invalid_argument("MappedRasterField::read_header: Values must be float32 or float64 in " + path);
+    if (rows > std::numeric_limits<size_t>::max() || columns > std::numeric_limits<size_t>::max())
+        throw std::invalid_argument("MappedRasterField::read_header: The dimensions of " + path + " exceed the addressable size");
+
+    return { value_size == sizeof(float) ? RasterType::Float32 : RasterType::Float64,
+             static_cast<size_t>(rows),
+             static_cast<size_t>(columns),
+             header_size };
+}
+
+/**
+ * Writes a raster header, the values are to be appended row by row
+ *
+ * @param path The file to create
+ * @param type The type of the values
+ * @param rows The number of nodes in the y direction
+ * @param columns The number of nodes in the x direction
+ */
+void MappedRasterField::write_header(const std::string& path, const RasterType type, const size_t rows, const size_t columns)
+{
+    std::ofstream file(path, std::ios::binary | std::ios::trunc);
+
+    const auto value_size = static_cast<uint32_t>(ValueSize(type));
+    const auto rows_64 = static_cast<uint64_t>(rows);
+    const auto columns_64 = static_cast<uint64_t>(columns);
+
+    file.write(RasterMagic, sizeof(RasterMagic));
+    file.write(reinterpret_cast<const char*>(&RasterVersion), sizeof(RasterVersion));
+    file.write(reinterpret_cast<const char*>(&value_size), sizeof(value_size));
+    file.write(reinterpret_cast<const char*>(&rows_64), sizeof(rows_64));
+    file.write(reinterpret_cast<const char*>(&columns_64), sizeof(columns_64));
+
+    if (!file)
+        throw std::runtime_error("MappedRasterField::write_header: Could not write " + path);
+}
+
+const char* MappedRasterField::row(const size_t iy) const
+{
+    return data_ + iy * columns_ * value_size_;
+}
+
+/**
+ * Gives back the pages holding only rows before iy - 1
+ *
+ * The sweep keeps its own copy of the rows it reads, so the mapping of a
+ * row is not needed anymore once the next one was read. Releasing clean
+ * file pages is always safe, they are read again if needed
+ *
+ * @param iy The row that was just read
+ */
+void MappedRasterField::release_rows_before(const size_t iy) const
+{
+    if (iy < 1)
+        return;
+
+    const auto page = PageSize();
+    const auto first = reinterpret_cast<uintptr_t>(row(iy - 1)) / page * page;
+    const auto last = reinterpret_cast<uintptr_t>(row(iy)) / page * page;
+    const auto begin = std::max(first, reinterpret_cast<uintptr_t>(mapping_) / page * page);
+
+    if (last <= begin)
+        return;
+
+#if defined(_WIN32)
+    // Unlocking pages that are not locked drops them from the working set
+    VirtualUnlock(reinterpret_cast<void*>(begin), last - begin);
+#else
+    madvise(reinterpret_cast<void*>(begin), last - begin, MADV_DONTNEED);
+#endif
+}
+
+double MappedRasterField::value(const size_t ix, const size_t iy) const
+{
+    const auto address = row(iy) + ix * value_size_;
+
+    if (type_ == RasterType::Float32)
+    {
+        float value;
+        std::memcpy(&value, address, sizeof(value));
+
+        return value;
+    }
+
+    double value;
+    std::memcpy(&value, address, sizeof(value));
+
+    return value;
+}
+
+void MappedRasterField::sample_line(const size_t ix, const size_t iy, const bool along_x, const size_t count, double* out) const
+{
+    if (!along_x)
+    {
+        ScalarField::sample_line(ix, iy, along_x, count, out);
+        return;
+    }
+
+    const auto first = row(iy) + ix * value_size_;
+
+    if (type_ == RasterType::Float32)
+    {
+        for (size_t k = 0; k < count; ++k)
+        {
+            float value;
+            std::memcpy(&value, first + k * sizeof(float), sizeof(value));
+            out[k] = value;
+        }
+    }
+    else
+        std::memcpy(out, first, count * sizeof(double));
+
+    release_rows_before(iy);
+}
+
+/**
+ * @return Y, rows follow each other in the file
+ */
+MajorAxis MappedRasterField::preferred_major_axis() const
+{
+    return MajorAxis::Y;
+}
+
+} // namespace marching_squares
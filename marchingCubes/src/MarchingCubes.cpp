@@ -0,0 +1,561 @@
+// Internal Includes
+#include "MarchingCubes.h"
+#include "ThreadPool.h"
+
+// Standard includes
+#include <algorithm>
+#include <functional>
+#include <limits>
+#include <stdexcept>
+
+namespace marching_squares {
+
+namespace {
+
+// The corners at the ends of every edge of a cube
+constexpr int CubeEdges[12][2] = {
+    { 0, 1 }, { 2, 3 }, { 4, 5 }, { 6, 7 },    // Along x
+    { 0, 2 }, { 1, 3 }, { 4, 6 }, { 5, 7 },    // Along y
+    { 0, 4 }, { 1, 5 }, { 2, 6 }, { 3, 7 }     // Along z
+};
+
+// The edges in the upper slice of a cube
+constexpr unsigned UpperSliceEdges = (1u << 2) | (1u << 3) | (1u << 6) | (1u << 7);
+
+// Per case: up to 5 triangles given by their edges, followed by -1
+using CaseTable = std::array<std::array<int8_t, 16>, 256>;
+
+int EdgeBetween(const int a, const int b)
+{
+    for (int e = 0; e < 12; ++e)
+        if ((CubeEdges[e][0] == a && CubeEdges[e][1] == b) || (CubeEdges[e][0] == b && CubeEdges[e][1] == a))
+            return e;
+
+    return -1;
+}
+
+// True if both edges lie on one face of the cube
+bool OnCommonFace(const int a, const int b)
+{
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const auto side = CubeEdges[a][0] >> axis & 1;
+
+        if ((CubeEdges[a][1] >> axis & 1) == side && (CubeEdges[b][0] >> axis & 1) == side && (CubeEdges[b][1] >> axis & 1) == side)
+            return true;
+    }
+
+    return false;
+}
+
+/**
+ * Derives the triangles of every case
+ *
+ * The corners of every face are walked counterclockwise seen from outside
+ * the cube. Each crossing into the corners above the iso value is joined
+ * to the next crossing out of them, so diagonal corners above the iso value
+ * stay apart. Every crossed edge then has one successor, and following
+ * them gives closed loops, which are triangulated as fans
+ *
+ * The fan starts where none of its diagonals joins two edges of one face.
+ * Such a diagonal could be made by the neighbouring cube as well, which
+ * would leave an edge shared by four triangles
+ */
+CaseTable BuildCaseTable()
+{
+    CaseTable table;
+
+    std::array<std::array<int, 4>, 6> faces;
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        const auto u = (axis + 1) % 3;
+        const auto v = (axis + 2) % 3;
+
+        for (int side = 0; side < 2; ++side)
+        {
+            // Counterclockwise around +axis, reversed for the face facing -axis
+            auto& face = faces[2 * axis + side];
+            face = { side << axis, side << axis | 1 << u, side << axis | 1 << u | 1 << v, side << axis | 1 << v };
+
+            if (side == 0)
+                std::reverse(face.begin(), face.end());
+        }
+    }
+
+    for (int cube = 0; cube < 256; ++cube)
+    {
+        int next[12];
+        std::fill(next, next + 12, -1);
+
+        for (const auto& face : faces)
+        {
+            for (int k = 0; k < 4; ++k)
+            {
+                const auto from = face[k], to = face[(k + 1) % 4];
+                if ((cube >> from & 1) || !(cube >> to & 1))
+                    continue;
+
+                for (int m = 1; m < 4; ++m)
+                {
+                    const auto from_out = face[(k + m) % 4], to_out = face[(k + m + 1) % 4];
+                    if ((cube >> from_out & 1) && !(cube >> to_out & 1))
+                    {
+                        next[EdgeBetween(from, to)] = EdgeBetween(from_out, to_out);
+                        break;
+                    }
+                }
+            }
+        }
+
+        auto& triangles = table[cube];
+        triangles.fill(-1);
+        size_t count = 0;
+
+        bool visited[12] = {};
+        for (int e = 0; e < 12; ++e)
+        {
+            if (next[e] < 0 || visited[e])
+                continue;
+
+            int loop[12];
+            int size = 0;
+
+            for (auto edge = e; !visited[edge]; edge = next[edge])
+            {
+                visited[edge] = true;
+                loop[size++] = edge;
+            }
+
+            // There is such a start for every loop of every case
+            int root = 0;
+            for (auto valid = false; !valid; )
+            {
+                valid = true;
+                for (int t = 2; t + 1 < size && valid; ++t)
+                    valid = !OnCommonFace(loop[root], loop[(root + t) % size]);
+
+                root += !valid;
+            }
+
+            for (int t = 1; t + 1 < size; ++t)
+            {
+                triangles[count++] = static_cast<int8_t>(loop[root]);
+                triangles[count++] = static_cast<int8_t>(loop[(root + t) % size]);
+                triangles[count++] = static_cast<int8_t>(loop[(root + t + 1) % size]);
+            }
+        }
+    }
+
+    return table;
+}
+
+const CaseTable& Cases()
+{
+    static const CaseTable table = BuildCaseTable();
+
+    return table;
+}
+
+} // namespace
+
+struct MarchingCubes::Slab
+{
+    // The layers of cubes between these z nodes
+    size_t begin = 0;
+    size_t end = 0;
+
+    // The slices shared with the neighbouring slabs, sampled up front
+    const double* first_values = nullptr;
+    const double* last_values = nullptr;
+
+    VerticesList3D vertices;
+    TrianglesList triangles;
+
+    // The vertex indices of the crossed edges of the first slice, the lower slab refers to them
+    std::vector<uint32_t> first_x_edges;
+    std::vector<uint32_t> first_y_edges;
+
+    // Triangle corners on the last slice of a slab below another one, those
+    // vertices belong to the upper slab: the position in the triangles and the edge
+    std::vector<std::array<size_t, 2>> foreign;
+};
+
+/**
+ * Constructor of the marching cubes class
+ *
+ * @param function The function to evaluate at the nodes
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ * @param z_limits The lower and upper bounds in the z direction
+ * @param resolution The number of cells in the x, y and z direction
+ */
+MarchingCubes::MarchingCubes(Function3D function,
+                             const Limits& x_limits,
+                             const Limits& y_limits,
+                             const Limits& z_limits,
+                             const Resolution3D& resolution):
+    MarchingCubes(std::make_shared<FunctionVolume>(std::move(function), x_limits, y_limits, z_limits, resolution),
+                  x_limits,
+                  y_limits,
+                  z_limits)
+{
+}
+
+/**
+ * Constructor of the marching cubes class from a volume
+ *
+ * @param volume The values at the nodes
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ * @param z_limits The lower and upper bounds in the z direction
+ */
+MarchingCubes::MarchingCubes(std::shared_ptr<const ScalarVolume> volume,
+                             const Limits& x_limits,
+                             const Limits& y_limits,
+                             const Limits& z_limits):
+    volume_(std::move(volume)),
+    resolution_(volume_->resolution()),
+    lower_({ x_limits[0], y_limits[0], z_limits[0] }),
+    step_({ (x_limits[1] - x_limits[0]) / resolution_[0],
+            (y_limits[1] - y_limits[0]) / resolution_[1],
+            (z_limits[1] - z_limits[0]) / resolution_[2] })
+{
+    if (resolution_[0] == 0 || resolution_[1] == 0 || resolution_[2] == 0)
+        throw std::invalid_argument("MarchingCubes::Constructor: The resolution must be at least one cell along every axis");
+}
+
+/**
+ * Adds a vertex on every crossed edge of a z slice
+ *
+ * @param slab The slab to add the vertices to
+ * @param values The values of the slice
+ * @param iz The z index of the slice
+ * @param iso_value The iso value
+ * @param x_edges Output, the vertex of edge (ix, iy) to (ix + 1, iy) at iy * nx + ix
+ * @param y_edges Output, the vertex of edge (ix, iy) to (ix, iy + 1) at iy * (nx + 1) + ix
+ */
+void MarchingCubes::emit_slice_vertices(Slab& slab,
+                                        const double* values,
+                                        const size_t iz,
+                                        const double iso_value,
+                                        uint32_t* x_edges,
+                                        uint32_t* y_edges) const
+{
+    const auto nx = resolution_[0], ny = resolution_[1];
+    const auto width = nx + 1;
+    const auto z = lower_[2] + iz * step_[2];
+
+    for (size_t iy = 0; iy <= ny; ++iy)
+    {
+        const auto* row = values + iy * width;
+        const auto y = lower_[1] + iy * step_[1];
+
+        for (size_t ix = 0; ix < nx; ++ix)
+        {
+            if ((row[ix] > iso_value) == (row[ix + 1] > iso_value))
+                continue;
+
+            const auto t = (iso_value - row[ix]) / (row[ix + 1] - row[ix]);
+
+            x_edges[iy * nx + ix] = static_cast<uint32_t>(slab.vertices.size());
+            slab.vertices.push_back({ lower_[0] + (ix + t) * step_[0], y, z });
+        }
+
+        if (iy == ny)
+            break;
+
+        const auto* next_row = row + width;
+
+        for (size_t ix = 0; ix <= nx; ++ix)
+        {
+            if ((row[ix] > iso_value) == (next_row[ix] > iso_value))
+                continue;
+
+            const auto t = (iso_value - row[ix]) / (next_row[ix] - row[ix]);
+
+            y_edges[iy * width + ix] = static_cast<uint32_t>(slab.vertices.size());
+            slab.vertices.push_back({ lower_[0] + ix * step_[0], lower_[1] + (iy + t) * step_[1], z });
+        }
+    }
+}
+
+/**
+ * Adds a vertex on every crossed edge between two z slices
+ *
+ * @param slab The slab to add the vertices to
+ * @param lower The values of slice iz
+ * @param upper The values of slice iz + 1
+ * @param iz The z index of the lower slice
+ * @param iso_value The iso value
+ * @param z_edges Output, the vertex of the edge at node (ix, iy) at iy * (nx + 1) + ix
+ */
+void MarchingCubes::emit_layer_vertices(Slab& slab,
+                                        const double* lower,
+                                        const double* upper,
+                                        const size_t iz,
+                                        const double iso_value,
+                                        uint32_t* z_edges) const
+{
+    const auto width = resolution_[0] + 1;
+
+    for (size_t iy = 0; iy <= resolution_[1]; ++iy)
+    {
+        for (size_t ix = 0; ix < width; ++ix)
+        {
+            const auto n = iy * width + ix;
+            if ((lower[n] > iso_value) == (upper[n] > iso_value))
+                continue;
+
+            const auto t = (iso_value - lower[n]) / (upper[n] - lower[n]);
+
+            z_edges[n] = static_cast<uint32_t>(slab.vertices.size());
+            slab.vertices.push_back({ lower_[0] + ix * step_[0], lower_[1] + iy * step_[1], lower_[2] + (iz + t) * step_[2] });
+        }
+    }
+}
+
+/**
+ * Sweeps the layers of a slab, keeping two slices at a time
+ *
+ * @param slab The slab, receives the vertices and triangles
+ * @param iso_value The iso value
+ */
+void MarchingCubes::sweep_slab(Slab& slab, const double iso_value) const
+{
+    const auto& cases = Cases();
+
+    const auto nx = resolution_[0], ny = resolution_[1];
+    const auto width = nx + 1;
+    const auto nodes = width * (ny + 1);
+    const auto x_edge_count = (ny + 1) * nx;
+
+    // The last slice of a slab below another one is only looked up, not added
+    const auto upper_is_foreign = slab.last_values != nullptr;
+
+    std::vector<double> buffers[2] = { std::vector<double>(nodes), std::vector<double>(nodes) };
+    std::vector<uint8_t> above[2] = { std::vector<uint8_t>(nodes), std::vector<uint8_t>(nodes) };
+
+    // The edge maps of the first slice are kept for stitching, the others alternate
+    slab.first_x_edges.resize(x_edge_count);
+    slab.first_y_edges.resize(ny * width);
+    std::vector<uint32_t> x_edges[2] = { std::vector<uint32_t>(x_edge_count), std::vector<uint32_t>(x_edge_count) };
+    std::vector<uint32_t> y_edges[2] = { std::vector<uint32_t>(ny * width), std::vector<uint32_t>(ny * width) };
+    std::vector<uint32_t> z_edges(nodes);
+
+    slab.vertices.clear();
+    slab.triangles.clear();
+    slab.foreign.clear();
+
+    const double* lower = slab.first_values;
+    if (!lower)
+    {
+        volume_->sample_slice(slab.begin, buffers[0].data());
+        lower = buffers[0].data();
+    }
+
+    emit_slice_vertices(slab, lower, slab.begin, iso_value, slab.first_x_edges.data(), slab.first_y_edges.data());
+
+    const uint32_t* lower_x = slab.first_x_edges.data();
+    const uint32_t* lower_y = slab.first_y_edges.data();
+
+    auto* lower_above = above[0].data();
+    auto* upper_above = above[1].data();
+    for (size_t n = 0; n < nodes; ++n)
+        lower_above[n] = lower[n] > iso_value;
+
+    for (size_t iz = slab.begin; iz < slab.end; ++iz)
+    {
+        const auto last = iz + 1 == slab.end;
+        const auto k = (iz - slab.begin) & 1;
+
+        const double* upper;
+        if (last && upper_is_foreign)
+            upper = slab.last_values;
+        else
+        {
+            auto* buffer = buffers[lower == buffers[0].data()].data();
+            volume_->sample_slice(iz + 1, buffer);
+            upper = buffer;
+        }
+
+        for (size_t n = 0; n < nodes; ++n)
+            upper_above[n] = upper[n] > iso_value;
+
+        emit_layer_vertices(slab, lower, upper, iz, iso_value, z_edges.data());
+
+        const auto foreign = last && upper_is_foreign;
+        if (!foreign)
+            emit_slice_vertices(slab, upper, iz + 1, iso_value, x_edges[k].data(), y_edges[k].data());
+
+        const uint32_t* upper_x = x_edges[k].data();
+        const uint32_t* upper_y = y_edges[k].data();
+
+        for (size_t iy = 0; iy < ny; ++iy)
+        {
+            for (size_t ix = 0; ix < nx; ++ix)
+            {
+                const auto n = iy * width + ix;
+
+                const unsigned cube = lower_above[n] | lower_above[n + 1] << 1 |
+                                      lower_above[n + width] << 2 | lower_above[n + width + 1] << 3 |
+                                      upper_above[n] << 4 | upper_above[n + 1] << 5 |
+                                      upper_above[n + width] << 6 | upper_above[n + width + 1] << 7;
+
+                if (cube == 0 || cube == 255)
+                    continue;
+
+                // The edge maps, or on a foreign upper slice the edges themselves
+                const size_t x0 = iy * nx + ix, x1 = x0 + nx;
+                const size_t edges[12] = {
+                    lower_x[x0], lower_x[x1],
+                    foreign ? x0 : upper_x[x0], foreign ? x1 : upper_x[x1],
+                    lower_y[n], lower_y[n + 1],
+                    foreign ? x_edge_count + n : upper_y[n], foreign ? x_edge_count + n + 1 : upper_y[n + 1],
+                    z_edges[n], z_edges[n + 1], z_edges[n + width], z_edges[n + width + 1]
+                };
+
+                const auto& triangles = cases[cube];
+                for (size_t c = 0; triangles[c] >= 0; c += 3)
+                {
+                    TriangleVertices triangle;
+
+                    for (size_t v = 0; v < 3; ++v)
+                    {
+                        const auto edge = triangles[c + v];
+
+                        if (foreign && (UpperSliceEdges >> edge & 1))
+                        {
+                            slab.foreign.push_back({ 3 * slab.triangles.size() + v, edges[edge] });
+                            triangle[v] = 0;
+                        }
+                        else
+                            triangle[v] = static_cast<uint32_t>(edges[edge]);
+                    }
+
+                    slab.triangles.push_back(triangle);
+                }
+            }
+        }
+
+        lower = upper;
+        lower_x = upper_x;
+        lower_y = upper_y;
+        std::swap(lower_above, upper_above);
+    }
+}
+
+/**
+ * Computes the isosurface for the given value
+ *
+ * @param iso_value The iso value
+ * @return The vertices and the triangles, as indices into the vertices
+ */
+std::tuple<VerticesList3D, TrianglesList> MarchingCubes::compute(const double iso_value) const
+{
+    // Hold on to the pool, it may be replaced meanwhile
+    const auto thread_pool = thread_pool_.pool();
+
+    const auto nz = resolution_[2];
+    const auto slab_count = thread_pool ? std::min(nz, (thread_pool->size() + 1) * slabs_per_thread_) : 1;
+    const auto nodes = (resolution_[0] + 1) * (resolution_[1] + 1);
+
+    std::vector<Slab> slabs(slab_count);
+    for (size_t k = 0; k < slab_count; ++k)
+    {
+        slabs[k].begin = nz * k / slab_count;
+        slabs[k].end = nz * (k + 1) / slab_count;
+    }
+
+    auto run = [&thread_pool](const size_t count, const std::function<void(size_t)>& body)
+    {
+        if (thread_pool)
+            thread_pool->parallel_for(count, body);
+        else
+            for (size_t k = 0; k < count; ++k)
+                body(k);
+    };
+
+    // The slices between slabs, sampled once for both of them
+    std::vector<std::vector<double>> seams(slab_count);
+    run(slab_count - 1, [&](const size_t k)
+    {
+        seams[k + 1].resize(nodes);
+        volume_->sample_slice(slabs[k + 1].begin, seams[k + 1].data());
+    });
+
+    for (size_t k = 1; k < slab_count; ++k)
+    {
+        slabs[k].first_values = seams[k].data();
+        slabs[k - 1].last_values = seams[k].data();
+    }
+
+    run(slab_count, [&](const size_t k)
+    {
+        sweep_slab(slabs[k], iso_value);
+    });
+
+    // Every slab goes after the ones below it
+    std::vector<size_t> vertex_offsets(slab_count + 1, 0);
+    std::vector<size_t> triangle_offsets(slab_count + 1, 0);
+
+    for (size_t k = 0; k < slab_count; ++k)
+    {
+        vertex_offsets[k + 1] = vertex_offsets[k] + slabs[k].vertices.size();
+        triangle_offsets[k + 1] = triangle_offsets[k] + slabs[k].triangles.size();
+    }
+
+    if (vertex_offsets.back() > size_t(std::numeric_limits<uint32_t>::max()) + 1)
+        throw std::length_error("MarchingCubes::compute: The surface has more vertices than 32 bit indices can address");
+
+    VerticesList3D vertices(vertex_offsets.back());
+    TrianglesList triangles(triangle_offsets.back());
+
+    run(slab_count, [&](const size_t k)
+    {
+        const auto& slab = slabs[k];
+        const auto base = static_cast<uint32_t>(vertex_offsets[k]);
+
+        std::copy(slab.vertices.begin(), slab.vertices.end(), vertices.begin() + vertex_offsets[k]);
+
+        auto* out = triangles.data() + triangle_offsets[k];
+        for (const auto& triangle : slab.triangles)
+            *out++ = { triangle[0] + base, triangle[1] + base, triangle[2] + base };
+
+        if (slab.foreign.empty())
+            return;
+
+        // Refer to the vertices the slab above added on the shared slice
+        const auto& upper = slabs[k + 1];
+        const auto upper_base = static_cast<uint32_t>(vertex_offsets[k + 1]);
+        const auto x_edge_count = upper.first_x_edges.size();
+
+        for (const auto& foreign : slab.foreign)
+        {
+            const auto edge = foreign[1];
+            auto& corner = triangles[triangle_offsets[k] + foreign[0] / 3][foreign[0] % 3];
+
+            corner = upper_base + (edge < x_edge_count ? upper.first_x_edges[edge] : upper.first_y_edges[edge - x_edge_count]);
+        }
+    });
+
+    return std::make_tuple(std::move(vertices), std::move(triangles));
+}
+
+/**
+ * Sets the number of threads used by compute
+ *
+ * It is safe to call while computations are running, they finish with the previous setting
+ *
+ * @param thread_count The number of threads, 0 picks the number of hardware threads
+ */
+void MarchingCubes::set_thread_count(const size_t thread_count)
+{
+    thread_pool_.set_thread_count(thread_count);
+}
+
+size_t MarchingCubes::thread_count() const
+{
+    return thread_pool_.thread_count();
+}
+
+} // namespace marching_squares
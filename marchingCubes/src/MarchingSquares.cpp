@@ -1,29 +1,222 @@
 // Internal Includes
 #include "MarchingSquares.h"
-#include "Node.h"
-#include "Edge.h"
+#include "Expression.h"
+#include "NodeClassifier.h"
+#include "ThreadPool.h"
 
 // Standard includes
+#include <algorithm>
+#include <chrono>
+#include <cmath>
 #include <iostream>
+#include <limits>
+#include <stdexcept>
+#include <unordered_map>
+#include <unordered_set>
 
 namespace marching_squares {
 
+// Marks an entry of an index map that has no vertex on its edge
+constexpr uint32_t NoVertex = std::numeric_limits<uint32_t>::max();
+
 /**
- * Converts the binary array to a single int
+ * The output of one iso level within a strip
  *
- * @param arr Array containing the bool values
- * @param size The size if the array (see array decay)
+ * All the vertices on the first column of a strip are emitted first,
+ * so for strips other than the first one, the leading seam_vertices
+ * entries are duplicates of the previous strip's last column and are
+ * dropped when stitching
+ */
+struct Workspace::StripLevel
+{
+    double iso_value = 0;
+
+    VerticesList vertices;
+    IndicesList indices;
+
+    // Vertex indices on the vertical edges of the previous and current column
+    std::vector<uint32_t> last_index_map;
+    std::vector<uint32_t> cur_index_map;
+
+    // Vertex indices on the vertical edges of the first column
+    std::vector<uint32_t> first_index_map;
+
+    // Nodes above and below the iso value on the previous and current column
+    NodeMask last_above, last_below;
+    NodeMask cur_above, cur_below;
+
+    size_t seam_vertices = 0;
+
+    // Index of vertices[0] in the whole output, only non zero while streaming
+    size_t vertex_base = 0;
+
+    // The tiles holding the contour when the field is cached, null to sweep whole columns
+    const ActiveTiles* tiles = nullptr;
+
+    ComputeStats stats;
+
+    // Global indices of the seam vertices, filled while stitching
+    std::vector<uint32_t> seam_map;
+};
+
+/**
+ * The part of the grid swept by one task, cells are processed for
+ * major axis nodes in [begin, end]
+ */
+struct Workspace::Strip
+{
+    size_t begin = 0;
+    size_t end = 0;
+
+    // Function values on the previous and current column
+    std::vector<double> last_col_func;
+    std::vector<double> cur_col_func;
+
+    // Coordinates handed to the field while sampling a column
+    LineScratch scratch;
+
+    // The cached field to read the columns from, null to sample them
+    const double* field_values = nullptr;
+
+    // The tiles to sample when the field was culled, null to sample whole columns
+    const ActiveTiles* sampled_tiles = nullptr;
+
+    // Sampling counters, the ones of the sweep are kept per level
+    ComputeStats stats;
+
+    // Counts the swept columns and asks to stop, null if nobody listens
+    ComputeProgress* progress = nullptr;
+
+    std::vector<StripLevel> levels;
+};
+
+/**
+ * The tiles of the cached field whose value range contains the iso value
  *
- * @return Integer value of the given binary number, or 0 if empty
+ * Tiles are tile_cells_ cells wide in both directions. Along the minor axis
+ * neighbouring tiles are merged into ranges [first, last) of tile indices
  */
-inline size_t ToInt(const bool arr[], const size_t size)
+struct Workspace::ActiveTiles
 {
-    size_t result = 0;
+    // The ranges of tile column I are ranges[range_offsets[I], range_offsets[I + 1])
+    std::vector<size_t> range_offsets;
+    std::vector<std::array<uint32_t, 2>> ranges;
 
-    for (size_t i = 0; i < size; ++i)
-        result |= static_cast<size_t>(arr[i]) << (size - i - 1);
+    // Scratch buffers of the selection
+    std::vector<uint32_t> selected;
+    std::vector<uint32_t> minor_tiles;
+    std::vector<size_t> cursor;
+};
 
-    return result;
+/**
+ * The sampled field and the value range of each of its tiles
+ */
+struct MarchingSquaresBase::FieldCache
+{
+    // Column i of the major axis starts at values[i * (nx2_ + 1)]
+    std::vector<double> values;
+
+    // Tile (I, J) is stored at I * minor_tiles + J. Tiles holding a NaN span everything
+    size_t major_tiles = 0;
+    size_t minor_tiles = 0;
+    std::vector<double> tile_min;
+    std::vector<double> tile_max;
+
+    // Span space: the tiles sorted by their minimum
+    std::vector<uint32_t> tiles_by_min;
+    std::vector<double> sorted_min;
+};
+
+EdgeListView::EdgeListView(VerticesList vertices, IndicesList indices):
+    vertices_(std::move(vertices)),
+    indices_(std::move(indices))
+{
+}
+
+size_t EdgeListView::size() const
+{
+    return indices_.size();
+}
+
+bool EdgeListView::empty() const
+{
+    return indices_.empty();
+}
+
+/**
+ * @return The end points of segment index
+ */
+EdgeListView::value_type EdgeListView::operator[](const size_t index) const
+{
+    const auto& segment = indices_[index];
+
+    return { vertices_[segment[0]], vertices_[segment[1]] };
+}
+
+EdgeListView::const_iterator EdgeListView::begin() const
+{
+    return const_iterator(this, 0);
+}
+
+EdgeListView::const_iterator EdgeListView::end() const
+{
+    return const_iterator(this, indices_.size());
+}
+
+const VerticesList& EdgeListView::vertices() const
+{
+    return vertices_;
+}
+
+const IndicesList& EdgeListView::indices() const
+{
+    return indices_;
+}
+
+/**
+ * @return All the segments, expanded to their end points
+ */
+EdgeList EdgeListView::to_edge_list() const
+{
+    EdgeList edge_list;
+    edge_list.reserve(indices_.size());
+
+    for (const auto& segment : indices_)
+        edge_list.push_back({ { vertices_[segment[0]], vertices_[segment[1]] } });
+
+    return edge_list;
+}
+
+Workspace::Workspace() = default;
+Workspace::~Workspace() = default;
+
+Workspace::Workspace(Workspace&& other) noexcept = default;
+Workspace& Workspace::operator=(Workspace&& other) noexcept = default;
+
+const VerticesList& Workspace::vertices() const
+{
+    return vertices_;
+}
+
+const IndicesList& Workspace::indices() const
+{
+    return indices_;
+}
+
+/**
+ * @return Per level the first vertex and the first index, with a final row holding the totals
+ */
+const OffsetTable& Workspace::offsets() const
+{
+    return offsets_;
+}
+
+/**
+ * @return The counters of the last computation, all zero unless built with MARCHING_SQUARES_STATS
+ */
+const ComputeStats& Workspace::stats() const
+{
+    return stats_;
 }
 
 inline Point2D LinearInterpolate(const Point2D& origin,
@@ -40,360 +233,2282 @@ inline Point2D LinearInterpolate(const Point2D& origin,
 }
 
 /**
- * Constructor of the marching squares class
+ * Constructor of the marching squares class from a batched function
+ *
+ * The function is called once per column with the coordinates of all its nodes
+ *
+ * @param function The function for which marching squares needs to be generated
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ * @param resolution The number of cells in the x and y direction
+ */
+MarchingSquaresBase::MarchingSquaresBase(BatchFunction function,
+                                         const Limits& x_limits,
+                                         const Limits& y_limits,
+                                         const Resolution& resolution):
+    MarchingSquaresBase(std::make_shared<BatchFunctionField>(std::move(function), x_limits, y_limits, verify_resolution(resolution)),
+                        x_limits,
+                        y_limits)
+{
+}
+
+/**
+ * Constructor of the marching squares class from a batched function with bounds
+ *
+ * The blocks of the grid where the range function rules out the iso value
+ * are not sampled, see BoundedField
  *
  * @param function The function for which marching squares needs to be generated
+ * @param range Bounds the values of the function over a rectangle
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ * @param resolution The number of cells in the x and y direction
+ */
+MarchingSquaresBase::MarchingSquaresBase(BatchFunction function,
+                                         RangeFunction range,
+                                         const Limits& x_limits,
+                                         const Limits& y_limits,
+                                         const Resolution& resolution):
+    MarchingSquaresBase(std::make_shared<BoundedField>(
+                            std::make_shared<BatchFunctionField>(std::move(function), x_limits, y_limits, verify_resolution(resolution)),
+                            std::move(range), x_limits, y_limits),
+                        x_limits,
+                        y_limits)
+{
+}
+
+/**
+ * Bounds a compiled expression by its interval arithmetic
+ */
+static RangeFunction ExpressionRange(const Expression& expression)
+{
+    return [expression](const Limits& x_range, const Limits& y_range)
+    {
+        return expression.range(x_range, y_range);
+    };
+}
+
+MarchingSquaresBase::MarchingSquaresBase(const Expression& expression,
+                                         const Limits& x_limits,
+                                         const Limits& y_limits,
+                                         const Resolution& resolution):
+    MarchingSquaresBase(BatchFunction(expression), ExpressionRange(expression), x_limits, y_limits, resolution)
+{
+}
+
+/**
+ * Constructor of the marching squares class from an expression
+ *
+ * The expression is compiled once and evaluated natively over whole columns.
+ * Its interval arithmetic bounds the field, so the blocks of the grid the
+ * contour provably misses are not sampled
+ *
+ * @param expression The function of x and y as text, like "sin(x**2 + y**2) - cos(x*y)"
  * @param x_limits The lower and upper bounds in the x direction
  * @param y_limits The lower and upper bounds in the y direction
  * @param resolution The number of cells in the x and y direction
  */
-MarchingSquares::MarchingSquares(Function function,
-                                 const Limits& x_limits,
-                                 const Limits& y_limits,
-                                 const Resolution& resolution):
-    function_(std::move(function)),
+MarchingSquaresBase::MarchingSquaresBase(const std::string& expression,
+                                         const Limits& x_limits,
+                                         const Limits& y_limits,
+                                         const Resolution& resolution):
+    MarchingSquaresBase(Expression(expression), x_limits, y_limits, resolution)
+{
+}
+
+/**
+ * Constructor of the marching squares class from any field source
+ *
+ * @param field The values at the grid nodes, its resolution is used for the grid
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ */
+MarchingSquaresBase::MarchingSquaresBase(std::shared_ptr<const ScalarField> field,
+                                         const Limits& x_limits,
+                                         const Limits& y_limits):
+    field_(std::move(field)),
     x_limits_(x_limits),
     y_limits_(y_limits),
-    resolution_(verify_resolution(resolution)),
+    resolution_(field_->resolution()),
     dx_((x_limits[1] - x_limits[0]) / resolution_[0]),
     dy_((y_limits[1] - y_limits[0]) / resolution_[1]),
-    cur_x_(x_limits[0]),
-    cur_y_(y_limits[0]),
-    x_major_(resolution[0] > resolution[1])
+    x_major_(field_->preferred_major_axis() == MajorAxis::Any ? resolution_[0] > resolution_[1] :
+             field_->preferred_major_axis() == MajorAxis::X)
+{
+    nx1_ = resolution_[!x_major_];
+    nx2_ = resolution_[x_major_];
+}
+
+/**
+ * Constructor of the marching squares class from an already sampled array
+ *
+ * The array is used in place, it must outlive the object
+ *
+ * @param values Pointer to the value at (x_limits[0], y_limits[0])
+ * @param rows The number of nodes in the y direction
+ * @param columns The number of nodes in the x direction
+ * @param row_stride The distance between two rows, in elements
+ * @param column_stride The distance between two columns, in elements
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ */
+MarchingSquaresBase::MarchingSquaresBase(const double* values,
+                                         const size_t rows,
+                                         const size_t columns,
+                                         const std::ptrdiff_t row_stride,
+                                         const std::ptrdiff_t column_stride,
+                                         const Limits& x_limits,
+                                         const Limits& y_limits):
+    MarchingSquaresBase(std::make_shared<StridedField<double>>(values, rows, columns, row_stride, column_stride),
+                        x_limits,
+                        y_limits)
+{
+}
+
+MarchingSquaresBase::MarchingSquaresBase(const float* values,
+                                         const size_t rows,
+                                         const size_t columns,
+                                         const std::ptrdiff_t row_stride,
+                                         const std::ptrdiff_t column_stride,
+                                         const Limits& x_limits,
+                                         const Limits& y_limits):
+    MarchingSquaresBase(std::make_shared<StridedField<float>>(values, rows, columns, row_stride, column_stride),
+                        x_limits,
+                        y_limits)
 {
-    nx1_ = resolution[!x_major_];
-    nx2_ = resolution[x_major_];
 }
 
-Resolution MarchingSquares::verify_resolution(const Resolution& resolution)
+Resolution MarchingSquaresBase::verify_resolution(const Resolution& resolution)
 {
     auto new_resolution = resolution;
     if (resolution[0] < 1 )
     {
-        std::cerr << "MarchingSquares::Constructor: The resolution in x direction must be greater than 0. Automatically setting it to 1\n";
+        std::cerr << "MarchingSquaresBase::Constructor: The resolution in x direction must be greater than 0. Automatically setting it to 1\n";
         new_resolution[0] = 1;
     }
     if (resolution[1] < 1)
     {
-        std::cerr << "MarchingSquares::Constructor: The resolution in y direction must be greater than 0. Automatically setting it to 1\n";
+        std::cerr << "MarchingSquaresBase::Constructor: The resolution in y direction must be greater than 0. Automatically setting it to 1\n";
         new_resolution[1] = 1;
     }
 
     return new_resolution;
 }
 
-EdgeVertices MarchingSquares::edge_id_to_nodes(const size_t id) const
+const EdgeIndexList& MarchingSquaresBase::case_to_edges(const size_t id) const
 {
-    if (id >= total_edges_)
-        return {};
-
-    return edge_to_vertices_[id];
-}
+    static const EdgeIndexList no_edges;
 
-EdgeIndexList MarchingSquares::case_to_edges(const size_t id) const
-{
     if (id >= total_cases_)
-        return {};
+        return no_edges;
 
     return lookup_table_[id];
 }
 
-void MarchingSquares::increment_minor_axis() const
+/**
+ * Returns the coordinates of a grid node
+ *
+ * @param i The node index along the major axis
+ * @param j The node index along the minor axis
+ */
+Point2D MarchingSquaresBase::node_point(const size_t i, const size_t j) const
 {
     if (x_major_)
-        cur_y_ += dy_;
-    else
-        cur_x_ += dx_;
-}
+        return { x_limits_[0] + i * dx_, y_limits_[0] + j * dy_ };
 
-void MarchingSquares::reset_minor_axis() const
-{
-    if (x_major_)
-        cur_y_ = y_limits_[0];
-    else
-        cur_x_ = x_limits_[0];
+    return { x_limits_[0] + j * dx_, y_limits_[0] + i * dy_ };
 }
 
-void MarchingSquares::increment_major_axis() const
+/**
+ * Samples all the nodes of a column of the major axis
+ *
+ * @param i The node index along the major axis
+ * @param column Output, receives the nx2_ + 1 values
+ * @param scratch The buffers the field may use, kept for the next column
+ */
+void MarchingSquaresBase::sample_column(const size_t i, std::vector<double>& column, LineScratch& scratch) const
 {
     if (x_major_)
-        cur_x_ += dx_;
+        field_->sample_line(i, 0, false, nx2_ + 1, column.data(), scratch);
     else
-        cur_y_ += dy_;
+        field_->sample_line(0, i, true, nx2_ + 1, column.data(), scratch);
 }
 
-void MarchingSquares::reset_major_axis() const
+/**
+ * Computes the contour as a list of segments given by their end points
+ *
+ * Runs compute_faster and expands its indices, so every node is sampled
+ * once. compute_view returns the same segments without expanding them
+ *
+ * @param iso_value The iso value
+ * @return The segments of the contour
+ */
+EdgeList MarchingSquaresBase::compute(const double iso_value) const
 {
-    if (x_major_)
-        cur_x_ = x_limits_[0];
-    else
-        cur_y_ = y_limits_[0];
+    return compute_view(iso_value).to_edge_list();
 }
 
-EdgeList MarchingSquares::compute(const double iso_value) const
+/**
+ * Computes the contour as a view that expands its segments on access
+ *
+ * @param iso_value The iso value
+ * @return The segments of the contour
+ */
+EdgeListView MarchingSquaresBase::compute_view(const double iso_value) const
 {
-    EdgeList edge_list;
-
-    // Extract the entries for better readability
-    const auto x_lower = x_limits_[0];
-    const auto x_upper = x_limits_[1];
-    const auto y_lower = y_limits_[0];
-    const auto y_upper = y_limits_[1];
-
-    const auto dx = (x_upper - x_lower) / resolution_[0];
-    const auto dy = (y_upper - y_lower) / resolution_[1];
-    
-    // Go over all the cells
-    for(size_t i = 0; i < resolution_[0]; ++i)
-    {
-        const auto x = x_lower + i * dx;
-
-        for(size_t j = 0; j < resolution_[1]; ++j)
-        {
-            const auto y = y_lower + j * dy;
-
-            // Calculate the node coordinates
-            std::array<Node, 4> nodes = { {
-                    {function_(x_lower +  i      * dx, y_lower + (j + 1) * dy), x,      y + dy},        //Node 1
-                    {function_(x_lower + (i + 1) * dx, y_lower + (j + 1) * dy), x + dx, y + dy},        //Node 2
-                    {function_(x_lower + (i + 1) * dx, y_lower +  j      * dy), x + dx, y     },        //Node 3
-                    {function_(x_lower +  i      * dx, y_lower +  j      * dy), x,      y     },        //Node 4
-                } };
-
-            // Compute the function signs based on iso value
-            bool func_signs[4];
-            
-            for(size_t k = 0; k < 4; ++k)
-            {
-                func_signs[k] = (iso_value - nodes[k].Value()) > 0;
-            }
-
-            // Compute the corresponding key from the function signs
-            const auto key = ToInt(func_signs, 4);
-
-            // Get the edges corresponding to the key
-            const auto edges = case_to_edges(key);
-            
-            // Compute and add the edge after interpolation
-            if (edges.size() == 2)
-            {
-                // Get the coordinates of the first edge
-                auto nodes_id = edge_id_to_nodes(edges[0]);
-                const auto origin = Edge(&nodes[nodes_id[0]], &nodes[nodes_id[1]]).GetIsoCoordinates(iso_value);
-
-                // Get the coordinates of the second edge
-                nodes_id = edge_id_to_nodes(edges[1]);
-                const auto target = Edge(&nodes[nodes_id[0]], &nodes[nodes_id[1]]).GetIsoCoordinates(iso_value);
-
-                edge_list.push_back({ {{origin[0], origin[1]}, 
-                                       {target[0], target[1]}} });
-            }
-            else if(edges.size() == 4)
-            {
-                auto nodes_id = edge_id_to_nodes(edges[0]);
-                auto point1 = Edge(&nodes[nodes_id[0]], &nodes[nodes_id[1]]).GetIsoCoordinates(iso_value);
-
-                nodes_id = edge_id_to_nodes(edges[1]);
-                const auto point2 = Edge(&nodes[nodes_id[0]], &nodes[nodes_id[1]]).GetIsoCoordinates(iso_value);
-
-                nodes_id = edge_id_to_nodes(edges[2]);
-                auto point3 = Edge(&nodes[nodes_id[0]], &nodes[nodes_id[1]]).GetIsoCoordinates(iso_value);
-
-                nodes_id = edge_id_to_nodes(edges[3]);
-                const auto point4 = Edge(&nodes[nodes_id[0]], &nodes[nodes_id[1]]).GetIsoCoordinates(iso_value);
-
-                // Sort based on the x-component of the array
-                if (point1[0] > point3[0])
-                    std::swap(point1, point3);
+    auto result = compute_faster(iso_value);
 
-                edge_list.push_back({ {{point1[0], point1[1]},
-                                       {point4[0], point4[1]}} });
-
-                edge_list.push_back({ {{point2[0], point2[1]},
-                                       {point3[0], point3[1]}} });
-            }
-        }
-    }
-
-    return edge_list;
+    return EdgeListView(std::move(std::get<0>(result)), std::move(std::get<1>(result)));
 }
 
-void MarchingSquares::check_vertical_edge(std::vector<double>& arr, const uint32_t index, const double iso_value, Point2D& last_point, std::vector<uint32_t>& index_map) const
+void MarchingSquaresBase::check_vertical_edge(StripLevel& level, const double* arr, const size_t i, const uint32_t j, std::vector<uint32_t>& index_map) const
 {
-    arr[static_cast<size_t>(index) + 1] = function_(cur_x_, cur_y_);
+    const auto next = static_cast<size_t>(j) + 1;
+    const auto iso_value = level.iso_value;
 
     // If function value signs are opposite
-    if ((arr[index] - iso_value) *
-        (arr[static_cast<size_t>(index) + 1] - iso_value) <= 0)
+    if ((arr[j] - iso_value) *
+        (arr[next] - iso_value) <= 0)
     {
-        vertices_.emplace_back(LinearInterpolate(last_point,
-            { cur_x_, cur_y_ },
-            { arr[index], arr[static_cast<size_t>(index) + 1] },
-            iso_value));
-
-        index_map[index] = vertex_count_;
+        index_map[j] = static_cast<uint32_t>(level.vertex_base + level.vertices.size());
 
-        ++vertex_count_;
+        level.vertices.emplace_back(LinearInterpolate(node_point(i, j),
+            node_point(i, next),
+            { arr[j], arr[next] },
+            iso_value));
     }
-    last_point = { cur_x_, cur_y_ };
 }
 
-void MarchingSquares::check_horizontal_edge(const Point2D&& values, double iso_value, Point2D&& last_point, uint32_t& index) const
+void MarchingSquaresBase::check_horizontal_edge(StripLevel& level, const Point2D&& values, const size_t i, const size_t j, uint32_t& index) const
 {
+    const auto iso_value = level.iso_value;
+
     if ((values[0] - iso_value) *
         (values[1] - iso_value) <= 0)
     {
-        vertices_.emplace_back(LinearInterpolate(last_point,
-            { cur_x_, cur_y_ },
+        index = static_cast<uint32_t>(level.vertex_base + level.vertices.size());
+
+        level.vertices.emplace_back(LinearInterpolate(node_point(i - 1, j),
+            node_point(i, j),
             values,
             iso_value));
-        index = vertex_count_;
-        ++vertex_count_;
     }
 }
 
-void MarchingSquares::reset() const
-{
-    reset_major_axis();
-    reset_minor_axis();
-}
-
-Point2D MarchingSquares::get_previous_horizontal_point() const
-{
-    if (x_major_)
-        return Point2D{ cur_x_ - dx_, cur_y_ };
-
-    return Point2D{ cur_x_, cur_y_ - dy_};
-}
-
-// In order to store minimum number of calculations, we play smart
-// We will return a vertex array object and an element index buffer
-std::tuple<VerticesList, IndicesList> MarchingSquares::compute_faster(const double iso_value) const
+/**
+ * Processes the cells between two columns for one iso level
+ *
+ * The nodes of the current column are classified against the iso value
+ * in bulk first. Cells with all four corners strictly above or strictly
+ * below the iso value have no vertex on any of their edges, so they are
+ * skipped without being looked at
+ *
+ * Only the cells in the given ranges of tiles are looked at. The cells
+ * outside of them must be empty, then the result is the same as for the
+ * whole column. Without a cached field there is one range over all cells
+ *
+ * @param level The level to add the vertices and indices to
+ * @param last_col_func The function values on column i - 1
+ * @param cur_col_func The function values on column i
+ * @param i The node index of the current column along the major axis
+ * @param ranges The ranges of tiles along the minor axis, [first, last) in tile_cells_ units
+ * @param range_count The number of ranges
+ */
+void MarchingSquaresBase::sweep_column(StripLevel& level, const double* last_col_func, const double* cur_col_func, const size_t i,
+                                       const std::array<uint32_t, 2>* ranges, const size_t range_count) const
 {
     // If the size was already known, we can use std::reserve
     // It turns out that allocating more memory and then reducing
     // it is more expensive than letting the vector do its thing
-    IndicesList indices;
-
-    // Pre-compute the function values at first column of the minor axis
-    std::vector<double> last_col_func(nx2_ + 1);
-    std::vector<double> cur_col_func(nx2_ + 1);
-
-    // Map to store the vertices index
-    std::vector<uint32_t> last_index_map(nx2_);
-    std::vector<uint32_t> cur_index_map(nx2_);
+    auto& indices = level.indices;
+    auto& last_index_map = level.last_index_map;
+    auto& cur_index_map = level.cur_index_map;
+    const auto& last_above = level.last_above;
+    const auto& cur_above = level.cur_above;
 
-    uint32_t top_index, bottom_index;
-    bool pattern[4];
+    uint32_t top_index = NoVertex, bottom_index = NoVertex;
     uint32_t assembled_point_indexes[4];
 
-    // Compute first point of the zeroth column
-    last_col_func[0] = function_(cur_x_, cur_y_);
-    Point2D last_point = { cur_x_, cur_y_ };
-    increment_minor_axis();
-
-    // Calculate rest of the entries of the zeroth column
-    for (uint32_t j = 0; j < nx2_; ++j)
+    // Classify the nodes of the ranges. With tiles, the previous column may have
+    // been classified for other ranges, so it is done again
+    for (size_t r = 0; r < range_count; ++r)
     {
-        check_vertical_edge(last_col_func, j, iso_value, last_point, last_index_map);
-        increment_minor_axis();
+        const auto first_node = static_cast<size_t>(ranges[r][0]) * tile_cells_;
+        const auto node_count = std::min<size_t>(static_cast<size_t>(ranges[r][1]) * tile_cells_, nx2_) - first_node + 1;
+
+        ClassifyNodes(cur_col_func + first_node, node_count, level.iso_value, level.cur_above.data() + ranges[r][0], level.cur_below.data() + ranges[r][0]);
+
+        if (level.tiles)
+            ClassifyNodes(last_col_func + first_node, node_count, level.iso_value, level.last_above.data() + ranges[r][0], level.last_below.data() + ranges[r][0]);
     }
-    reset_minor_axis();
-    increment_major_axis();
 
-    // Go over all the cells, iterating primarily over minor axis (smaller boundary, less storage)
-    for (uint32_t i = 0; i < nx1_; ++i)
+    // Check the first horizontal edge, if it is in a tile with a crossing at all
+    if (range_count > 0 && ranges[0][0] == 0)
     {
-        // Compute the first entry of the current column
-        cur_col_func[0] = function_(cur_x_, cur_y_);
-        last_point = { cur_x_, cur_y_ };
-
-        // Check the first horizontal edge
-        check_horizontal_edge(
+        check_horizontal_edge(level,
             { last_col_func[0], cur_col_func[0] },
-            iso_value,
-            get_previous_horizontal_point(),
+            i, 0,
             bottom_index);
+    }
 
-        increment_minor_axis();
+    const auto words = cur_above.size();
 
-        for (uint32_t j = 0; j < nx2_; ++j)
+    // The words of the masks are as large as the tiles along the minor axis, bottom_index
+    // is stale at the start of a range but the edge below the range has no vertex
+    for (size_t r = 0; r < range_count; ++r)
+    {
+        for (size_t w = ranges[r][0]; w < ranges[r][1]; ++w)
         {
-            check_vertical_edge(cur_col_func, j, iso_value, last_point, cur_index_map);
-
-            // Now we compute the coordinates of the new vertex on the horizontal edge
-            check_horizontal_edge(
-                { last_col_func[static_cast<size_t>(j) + 1], cur_col_func[static_cast<size_t>(j) + 1] },
-                iso_value,
-                get_previous_horizontal_point(),
-                top_index);
-
-            assembled_point_indexes[0] = bottom_index;
-            assembled_point_indexes[1] = cur_index_map[j];
-            assembled_point_indexes[2] = top_index;
-            assembled_point_indexes[3] = last_index_map[j];
-
-            // Check the cells case
-            pattern[0] = last_col_func[j] - iso_value > 0;
-            pattern[1] = cur_col_func[j] - iso_value > 0;
-            pattern[2] = cur_col_func[static_cast<size_t>(j) + 1] - iso_value > 0;
-            pattern[3] = last_col_func[static_cast<size_t>(j) + 1] - iso_value > 0;
-
-            const auto key = ToInt(pattern, 4);
-            const auto intersected_edges = case_to_edges(key);
-
-            if (intersected_edges.size() == 2)
-            {
-                indices.emplace_back(std::array<uint32_t, 2> {
-                    assembled_point_indexes[intersected_edges[0]],
-                        assembled_point_indexes[intersected_edges[1]]
-                });
-            }
-            // Ambiguous cases
-            else if (intersected_edges.size() == 4)
+            // Nodes on the same side in both columns, and the same for the word above
+            const auto both_above = last_above[w] & cur_above[w];
+            const auto both_below = level.last_below[w] & level.cur_below[w];
+            const auto next_above = w + 1 < words ? last_above[w + 1] & cur_above[w + 1] : 0;
+            const auto next_below = w + 1 < words ? level.last_below[w + 1] & level.cur_below[w + 1] : 0;
+
+            // A cell is empty if both its lower and upper nodes are on the same side
+            const auto empty_above = both_above & ((both_above >> 1) | (next_above << 63));
+            const auto empty_below = both_below & ((both_below >> 1) | (next_below << 63));
+
+            // Mask out the bits past the last cell
+            const auto first_cell = w * 64;
+            const auto cell_count = std::min<size_t>(64, nx2_ - std::min(nx2_, first_cell));
+            const auto valid = cell_count == 64 ? ~uint64_t(0) : (uint64_t(1) << cell_count) - 1;
+
+            auto active = ~(empty_above | empty_below) & valid;
+
+            while (active)
             {
-                // We sort by the x component
-                if (vertices_[assembled_point_indexes[0]][0] > 
-                    vertices_[assembled_point_indexes[2]][0])
+                const auto j = static_cast<uint32_t>(first_cell + CountTrailingZeros(active));
+                const auto next = static_cast<size_t>(j) + 1;
+                active &= active - 1;
+
+                check_vertical_edge(level, cur_col_func, i, j, cur_index_map);
+
+                // Now we compute the coordinates of the new vertex on the horizontal edge
+                check_horizontal_edge(level,
+                    { last_col_func[next], cur_col_func[next] },
+                    i, next,
+                    top_index);
+
+                // If the cell below was skipped, bottom_index is stale. The bottom
+                // edge then has no vertex either and is not referred to
+                assembled_point_indexes[0] = bottom_index;
+                assembled_point_indexes[1] = cur_index_map[j];
+                assembled_point_indexes[2] = top_index;
+                assembled_point_indexes[3] = last_index_map[j];
+
+                // Check the cells case, in the order (Node0, Node1, Node2, Node3)
+                const auto key = MaskBit(last_above, j) << 3 |
+                                 MaskBit(cur_above, j) << 2 |
+                                 MaskBit(cur_above, next) << 1 |
+                                 MaskBit(last_above, next);
+
+                const auto& intersected_edges = case_to_edges(key);
+
+                if (intersected_edges.size() == 2)
                 {
                     indices.emplace_back(std::array<uint32_t, 2> {
                         assembled_point_indexes[intersected_edges[0]],
                             assembled_point_indexes[intersected_edges[1]]
                     });
-
-                    indices.emplace_back(std::array<uint32_t, 2> {
-                        assembled_point_indexes[intersected_edges[2]],
-                            assembled_point_indexes[intersected_edges[3]]
-                    });
                 }
-                else
+                // Ambiguous cases
+                else if (intersected_edges.size() == 4)
                 {
-                    indices.emplace_back(std::array<uint32_t, 2> {
-                        assembled_point_indexes[intersected_edges[0]],
-                            assembled_point_indexes[intersected_edges[3]]
-                    });
-
-                    indices.emplace_back(std::array<uint32_t, 2> {
-                        assembled_point_indexes[intersected_edges[1]],
-                            assembled_point_indexes[intersected_edges[2]]
-                    });
+                    MARCHING_SQUARES_STAT(++level.stats.ambiguous_cells;)
+
+                    // We sort by the x component. Both vertices are on the current column, so never streamed out yet
+                    if (level.vertices[assembled_point_indexes[0] - level.vertex_base][0] >
+                        level.vertices[assembled_point_indexes[2] - level.vertex_base][0])
+                    {
+                        indices.emplace_back(std::array<uint32_t, 2> {
+                            assembled_point_indexes[intersected_edges[0]],
+                                assembled_point_indexes[intersected_edges[1]]
+                        });
+
+                        indices.emplace_back(std::array<uint32_t, 2> {
+                            assembled_point_indexes[intersected_edges[2]],
+                                assembled_point_indexes[intersected_edges[3]]
+                        });
+                    }
+                    else
+                    {
+                        indices.emplace_back(std::array<uint32_t, 2> {
+                            assembled_point_indexes[intersected_edges[0]],
+                                assembled_point_indexes[intersected_edges[3]]
+                        });
+
+                        indices.emplace_back(std::array<uint32_t, 2> {
+                            assembled_point_indexes[intersected_edges[1]],
+                                assembled_point_indexes[intersected_edges[2]]
+                        });
+                    }
                 }
-            }
 
-            bottom_index = top_index;
-            increment_minor_axis();
+                bottom_index = top_index;
+            }
         }
-        last_index_map.swap(cur_index_map);
-        last_col_func.swap(cur_col_func);
+    }
+    last_index_map.swap(cur_index_map);
+    level.last_above.swap(level.cur_above);
+    level.last_below.swap(level.cur_below);
+}
+
+/**
+ * Emits the vertices on the vertical edges of a column
+ *
+ * @param level The level to add the vertices to, its last_index_map receives their indices
+ * @param column The function values on the column
+ * @param i The node index of the column along the major axis
+ */
+void MarchingSquaresBase::seed_column(StripLevel& level, const double* column, const size_t i) const
+{
+    for (uint32_t j = 0; j < nx2_; ++j)
+        check_vertical_edge(level, column, i, j, level.last_index_map);
+}
+
+/**
+ * Returns the function values on a column of the major axis
+ *
+ * When the field was culled, only the nodes of the sampled tiles on either
+ * side of the column are sampled, except on the first column of the strip.
+ * The other values in the buffer are left as they are and never read
+ *
+ * @param strip The strip, if it has a cached field the values are read from there
+ * @param i The node index along the major axis
+ * @param buffer The buffer to sample the column into otherwise
+ */
+const double* MarchingSquaresBase::column_values(Strip& strip, const size_t i, std::vector<double>& buffer) const
+{
+    if (strip.field_values)
+        return strip.field_values + i * (nx2_ + 1);
+
+    if (!strip.sampled_tiles || i == strip.begin)
+    {
+        sample_column(i, buffer, strip.scratch);
+        MARCHING_SQUARES_STAT(strip.stats.node_evaluations += nx2_ + 1;)
 
-        reset_minor_axis();
-        increment_major_axis();
+        return buffer.data();
     }
-    reset();
 
-    vertex_count_ = 0;
+    const auto& tiles = *strip.sampled_tiles;
+    const auto tile_columns = tiles.range_offsets.size() - 1;
+
+    // The column closes the cells of tile column (i - 1) / tile_cells_, on a border it opens the next one
+    for (auto I = (i - 1) / tile_cells_; I <= i / tile_cells_ && I < tile_columns; ++I)
+    {
+        for (auto r = tiles.range_offsets[I]; r < tiles.range_offsets[I + 1]; ++r)
+        {
+            const auto first_node = static_cast<size_t>(tiles.ranges[r][0]) * tile_cells_;
+            const auto node_count = std::min<size_t>(static_cast<size_t>(tiles.ranges[r][1]) * tile_cells_, nx2_) - first_node + 1;
+
+            if (x_major_)
+                field_->sample_line(i, first_node, false, node_count, buffer.data() + first_node, strip.scratch);
+            else
+                field_->sample_line(first_node, i, true, node_count, buffer.data() + first_node, strip.scratch);
+
+            MARCHING_SQUARES_STAT(strip.stats.node_evaluations += node_count;)
+        }
+    }
 
-    // Vertices_ will implicitly be reset due to std::move
-    return { std::move(vertices_), std::move(indices) };
+    return buffer.data();
 }
+
+/**
+ * Samples the first column of a strip and prepares its levels
+ *
+ * @param strip The strip to start, begin and the levels' iso values must be set
+ */
+void MarchingSquaresBase::start_strip(Strip& strip) const
+{
+    // Pre-compute the function values at first column of the minor axis
+    strip.last_col_func.resize(nx2_ + 1);
+    strip.cur_col_func.resize(nx2_ + 1);
+
+    strip.stats = ComputeStats();
+    MARCHING_SQUARES_STAT(auto clock = std::chrono::steady_clock::now();)
+
+    // Compute the first column of the strip
+    const auto last_col_func = column_values(strip, strip.begin, strip.last_col_func);
+
+    MARCHING_SQUARES_STAT(strip.stats.sample_seconds += Lap(clock);)
+
+    for (auto& level : strip.levels)
+    {
+        // Buffers of a previous call keep their capacity
+        level.vertices.clear();
+        level.indices.clear();
+        level.seam_vertices = 0;
+        level.vertex_base = 0;
+        level.stats = ComputeStats();
+
+        // Map to store the vertices index
+        level.last_index_map.assign(nx2_, NoVertex);
+        level.cur_index_map.resize(nx2_);
+
+        const auto words = MaskWords(nx2_ + 1);
+        level.last_above.resize(words);
+        level.last_below.resize(words);
+        level.cur_above.resize(words);
+        level.cur_below.resize(words);
+
+        ClassifyNodes(last_col_func, nx2_ + 1, level.iso_value, level.last_above.data(), level.last_below.data());
+
+        seed_column(level, last_col_func, strip.begin);
+
+        // The first column is shared with the previous strip
+        if (strip.begin > 0)
+        {
+            level.first_index_map = level.last_index_map;
+            level.seam_vertices = level.vertices.size();
+        }
+    }
+}
+
+/**
+ * Sweeps over the cells of a strip for all the levels
+ *
+ * Every column is sampled once and then scanned for each level. With a
+ * cached field the columns are read in place and only the cells in the
+ * tiles of each level are scanned. A culled field is scanned the same way,
+ * sampling only the nodes of the tiles left
+ *
+ * @param strip The strip to process, begin, end and the levels' iso values must be set
+ */
+void MarchingSquaresBase::sweep_strip(Strip& strip) const
+{
+    start_strip(strip);
+
+    const std::array<uint32_t, 2> all_cells = { 0, static_cast<uint32_t>(MaskWords(nx2_)) };
+    const auto* last_col_func = strip.field_values ? column_values(strip, strip.begin, strip.last_col_func) : strip.last_col_func.data();
+
+    // Go over all the cells, iterating primarily over minor axis (smaller boundary, less storage)
+    for (size_t i = strip.begin + 1; i <= strip.end; ++i)
+    {
+        MARCHING_SQUARES_STAT(auto clock = std::chrono::steady_clock::now();)
+
+        // Fetch the whole current column at once
+        const auto cur_col_func = column_values(strip, i, strip.cur_col_func);
+
+        MARCHING_SQUARES_STAT(strip.stats.sample_seconds += Lap(clock);)
+
+        for (auto& level : strip.levels)
+        {
+            MARCHING_SQUARES_STAT(
+                const auto vertex_capacity = level.vertices.capacity();
+                const auto index_capacity = level.indices.capacity();
+            )
+
+            if (level.tiles)
+            {
+                const auto tile_column = (i - 1) / tile_cells_;
+                const auto first = level.tiles->range_offsets[tile_column];
+                const auto last = level.tiles->range_offsets[tile_column + 1];
+
+                sweep_column(level, last_col_func, cur_col_func, i, level.tiles->ranges.data() + first, last - first);
+            }
+            else
+                sweep_column(level, last_col_func, cur_col_func, i, &all_cells, 1);
+
+            MARCHING_SQUARES_STAT(
+                TrackGrowth(level.stats, vertex_capacity, level.vertices.capacity(), sizeof(Point2D));
+                TrackGrowth(level.stats, index_capacity, level.indices.capacity(), sizeof(EdgeVertices));
+            )
+        }
+
+        MARCHING_SQUARES_STAT(strip.stats.sweep_seconds += Lap(clock);)
+
+        if (strip.field_values)
+            last_col_func = cur_col_func;
+        else
+        {
+            strip.last_col_func.swap(strip.cur_col_func);
+            last_col_func = strip.last_col_func.data();
+        }
+
+        if (strip.progress)
+        {
+            strip.progress->columns_done.fetch_add(1, std::memory_order_relaxed);
+
+            if (strip.progress->cancel_requested.load(std::memory_order_relaxed))
+                return;
+        }
+    }
+}
+
+/**
+ * Lays the swept strips out in the output without copying them yet
+ *
+ * The levels are stored one after the other, each of them in strip order.
+ * The vertices on the seam between two strips are computed by both of them
+ * from the same function values. Only the copy of the previous strip is kept
+ * and the indices of the next strip are redirected to it through its seam map
+ *
+ * @param workspace The workspace holding the swept strips, ordered along the major axis
+ */
+void MarchingSquaresBase::plan_output(Workspace& workspace) const
+{
+    auto& strips = workspace.strips_;
+    auto& part_offsets = workspace.part_offsets_;
+    auto& offsets = workspace.offsets_;
+
+    const auto strip_count = strips.size();
+    const auto level_count = strips.front().levels.size();
+
+    part_offsets.assign(level_count * strip_count + 1, { 0, 0 });
+    offsets.resize(level_count + 1);
+
+    for (size_t l = 0; l < level_count; ++l)
+    {
+        offsets[l] = part_offsets[l * strip_count];
+
+        for (size_t k = 0; k < strip_count; ++k)
+        {
+            const auto& level = strips[k].levels[l];
+            const auto part = l * strip_count + k;
+
+            part_offsets[part + 1][0] = part_offsets[part][0] + level.vertices.size() - level.seam_vertices;
+            part_offsets[part + 1][1] = part_offsets[part][1] + level.indices.size();
+        }
+    }
+    offsets[level_count] = part_offsets.back();
+
+    // Indices beyond the limit wrapped around while sweeping, the contour has to be chunked
+    if (offsets[level_count][0] > MaxIndexedVertices)
+        throw std::length_error("MarchingSquares::plan_output: The contour has more vertices than 32 bit indices can address, use compute_chunked");
+
+    for (size_t l = 0; l < level_count; ++l)
+    {
+        for (size_t k = 0; k < strip_count; ++k)
+        {
+            auto& level = strips[k].levels[l];
+            level.seam_map.resize(level.seam_vertices);
+
+            if (k == 0)
+                continue;
+
+            const auto& previous = strips[k - 1].levels[l];
+            const auto previous_offset = part_offsets[l * strip_count + k - 1][0] - previous.seam_vertices;
+
+            for (size_t j = 0; j < nx2_; ++j)
+            {
+                const auto local = level.first_index_map[j];
+
+                if (local != NoVertex)
+                    level.seam_map[local] = static_cast<uint32_t>(previous_offset + previous.last_index_map[j]);
+            }
+        }
+    }
+
+    workspace.written_ = { 0, 0 };
+}
+
+/**
+ * Copies the laid out strips into output buffers, from where the last copy stopped
+ *
+ * As many vertices and indices as fit are copied, independently of each
+ * other. The indices refer to the vertices of the whole output
+ *
+ * The vertices are converted on the way, so output in another format is
+ * written straight from the strips without a merged copy in double precision
+ *
+ * @param workspace The workspace holding the planned strips, see plan_output
+ * @param vertices The memory to copy the vertices to, filled from its start
+ * @param vertex_capacity The number of vertices that fit
+ * @param indices The memory to copy the indices to, filled from its start
+ * @param index_capacity The number of indices that fit
+ * @param convert Maps a Point2D to a Vertex
+ * @param thread_pool The pool to copy on, null to do it on the calling thread
+ *
+ * @return The number of vertices and indices copied
+ */
+template <typename Vertex, typename Convert>
+std::array<size_t, 2> MarchingSquaresBase::write_parts(Workspace& workspace,
+                                                       Vertex* vertices,
+                                                       const size_t vertex_capacity,
+                                                       EdgeVertices* indices,
+                                                       const size_t index_capacity,
+                                                       const Convert& convert,
+                                                       ThreadPool* thread_pool) const
+{
+    const auto& strips = workspace.strips_;
+    const auto& part_offsets = workspace.part_offsets_;
+    const auto written = workspace.written_;
+
+    const auto part_count = part_offsets.size() - 1;
+    const auto strip_count = strips.size();
+
+    const auto vertex_end = std::min(part_offsets.back()[0], written[0] + vertex_capacity);
+    const auto index_end = std::min(part_offsets.back()[1], written[1] + index_capacity);
+
+    const auto write_part = [&](const size_t part)
+    {
+        const auto& level = strips[part % strip_count].levels[part / strip_count];
+        const auto seam = level.seam_vertices;
+        const auto offset = part_offsets[part][0];
+
+        // The share of the part within this copy
+        const auto first_vertex = std::max(offset, written[0]);
+        const auto last_vertex = std::min(part_offsets[part + 1][0], vertex_end);
+
+        if (first_vertex < last_vertex)
+            std::transform(level.vertices.begin() + (seam + first_vertex - offset),
+                           level.vertices.begin() + (seam + last_vertex - offset),
+                           vertices + (first_vertex - written[0]),
+                           convert);
+
+        const auto first_index = std::max(part_offsets[part][1], written[1]);
+        const auto last_index = std::min(part_offsets[part + 1][1], index_end);
+
+        const auto remap = [&](const uint32_t local)
+        {
+            return local < seam ? level.seam_map[local] : static_cast<uint32_t>(offset + local - seam);
+        };
+
+        auto out = indices + (first_index - written[1]);
+        for (auto k = first_index; k < last_index; ++k)
+        {
+            const auto& edge = level.indices[k - part_offsets[part][1]];
+            *out++ = { remap(edge[0]), remap(edge[1]) };
+        }
+    };
+
+    if (thread_pool)
+        thread_pool->parallel_for(part_count, write_part);
+    else
+        for (size_t part = 0; part < part_count; ++part)
+            write_part(part);
+
+    workspace.written_ = { vertex_end, index_end };
+
+    return { vertex_end - written[0], index_end - written[1] };
+}
+
+/**
+ * Copies the laid out strips into output buffers, from where the last copy stopped
+ *
+ * @param workspace The workspace holding the planned strips, see plan_output
+ * @param buffers The memory to copy to, filled from its start
+ * @param thread_pool The pool to copy on, null to do it on the calling thread
+ *
+ * @return The number of vertices and indices copied
+ */
+std::array<size_t, 2> MarchingSquaresBase::write_parts(Workspace& workspace, const OutputBuffers& buffers, ThreadPool* thread_pool) const
+{
+    const auto copy = [](const Point2D& vertex) { return vertex; };
+
+    return write_parts(workspace, buffers.vertices, buffers.vertex_capacity, buffers.indices, buffers.index_capacity, copy, thread_pool);
+}
+
+/**
+ * Merges the strips of the workspace into its output buffers
+ *
+ * The result is the same as sweeping the whole grid at once
+ *
+ * @param workspace The workspace holding the swept strips, ordered along the major axis
+ * @param thread_pool The pool to stitch the strips on, null to do it on the calling thread
+ */
+void MarchingSquaresBase::stitch_strips(Workspace& workspace, ThreadPool* thread_pool) const
+{
+    plan_output(workspace);
+
+    auto& strips = workspace.strips_;
+
+    // Nothing to stitch, swap the buffers so both keep their capacity
+    if (strips.size() == 1 && strips.front().levels.size() == 1)
+    {
+        auto& level = strips.front().levels.front();
+
+        workspace.vertices_.swap(level.vertices);
+        workspace.indices_.swap(level.indices);
+
+        // The strip gets the previous output back, make it as large as this one
+        // so the next sweep does not grow it again
+        level.vertices.reserve(workspace.vertices_.size());
+        level.indices.reserve(workspace.indices_.size());
+
+        return;
+    }
+
+    auto& vertices = workspace.vertices_;
+    auto& indices = workspace.indices_;
+
+    MARCHING_SQUARES_STAT(
+        const auto vertex_capacity = vertices.capacity();
+        const auto index_capacity = indices.capacity();
+    )
+
+    vertices.resize(workspace.offsets_.back()[0]);
+    indices.resize(workspace.offsets_.back()[1]);
+
+    MARCHING_SQUARES_STAT(
+        TrackGrowth(workspace.stats_, vertex_capacity, vertices.capacity(), sizeof(Point2D));
+        TrackGrowth(workspace.stats_, index_capacity, indices.capacity(), sizeof(EdgeVertices));
+    )
+
+    OutputBuffers buffers;
+    buffers.vertices = vertices.data();
+    buffers.vertex_capacity = vertices.size();
+    buffers.indices = indices.data();
+    buffers.index_capacity = indices.size();
+
+    write_parts(workspace, buffers, thread_pool);
+}
+
+/**
+ * Samples the whole grid and computes the value range of every tile
+ *
+ * @param thread_pool The pool to sample on, null to do it on the calling thread
+ *
+ * @return The cache
+ */
+std::shared_ptr<const MarchingSquaresBase::FieldCache> MarchingSquaresBase::build_field_cache(ThreadPool* thread_pool) const
+{
+    const auto cache = std::make_shared<FieldCache>();
+    const auto rows = nx2_ + 1;
+
+    cache->values.resize((nx1_ + 1) * rows);
+    cache->major_tiles = (nx1_ + tile_cells_ - 1) / tile_cells_;
+    cache->minor_tiles = (nx2_ + tile_cells_ - 1) / tile_cells_;
+    cache->tile_min.resize(cache->major_tiles * cache->minor_tiles);
+    cache->tile_max.resize(cache->major_tiles * cache->minor_tiles);
+
+    // Every batch samples tile_cells_ columns, the last one also the final column
+    const auto sample_batch = [&](const size_t I)
+    {
+        const auto first = I * tile_cells_;
+        const auto last = std::min(first + tile_cells_, nx1_ + 1);
+
+        LineScratch scratch;
+
+        for (auto i = first; i < last; ++i)
+        {
+            if (x_major_)
+                field_->sample_line(i, 0, false, rows, &cache->values[i * rows], scratch);
+            else
+                field_->sample_line(0, i, true, rows, &cache->values[i * rows], scratch);
+        }
+    };
+
+    // The nodes on the border of a tile belong to both neighbours
+    const auto measure_tiles = [&](const size_t I)
+    {
+        const auto first = I * tile_cells_;
+        const auto last = std::min(first + tile_cells_, nx1_);
+
+        for (size_t J = 0; J < cache->minor_tiles; ++J)
+        {
+            const auto first_node = J * tile_cells_;
+            const auto last_node = std::min(first_node + tile_cells_, nx2_);
+
+            auto low = std::numeric_limits<double>::infinity();
+            auto high = -std::numeric_limits<double>::infinity();
+            auto has_nan = false;
+
+            for (auto i = first; i <= last; ++i)
+            {
+                const auto column = &cache->values[i * rows];
+
+                for (auto j = first_node; j <= last_node; ++j)
+                {
+                    const auto value = column[j];
+
+                    low = value < low ? value : low;
+                    high = value > high ? value : high;
+                    has_nan = has_nan || value != value;
+                }
+            }
+
+            // A NaN makes its cells non empty for every iso value
+            if (has_nan)
+            {
+                low = -std::numeric_limits<double>::infinity();
+                high = std::numeric_limits<double>::infinity();
+            }
+
+            cache->tile_min[I * cache->minor_tiles + J] = low;
+            cache->tile_max[I * cache->minor_tiles + J] = high;
+        }
+    };
+
+    const auto batches = (nx1_ + tile_cells_) / tile_cells_;
+
+    if (thread_pool)
+    {
+        thread_pool->parallel_for(batches, sample_batch);
+        thread_pool->parallel_for(cache->major_tiles, measure_tiles);
+    }
+    else
+    {
+        for (size_t I = 0; I < batches; ++I)
+            sample_batch(I);
+        for (size_t I = 0; I < cache->major_tiles; ++I)
+            measure_tiles(I);
+    }
+
+    const auto tile_count = cache->tile_min.size();
+    const auto& tile_min = cache->tile_min;
+
+    cache->tiles_by_min.resize(tile_count);
+    for (size_t t = 0; t < tile_count; ++t)
+        cache->tiles_by_min[t] = static_cast<uint32_t>(t);
+
+    std::sort(cache->tiles_by_min.begin(), cache->tiles_by_min.end(), [&tile_min](const uint32_t a, const uint32_t b)
+    {
+        return tile_min[a] < tile_min[b];
+    });
+
+    cache->sorted_min.resize(tile_count);
+    for (size_t t = 0; t < tile_count; ++t)
+        cache->sorted_min[t] = tile_min[cache->tiles_by_min[t]];
+
+    return cache;
+}
+
+/**
+ * Finds the tiles whose value range contains the iso value
+ *
+ * The tiles with a minimum up to the iso value are a prefix of the span
+ * space list, of those only the ones with a maximum of at least the iso
+ * value are kept. All the other tiles hold nodes strictly on one side of
+ * the iso value only, so none of their cells has a vertex
+ *
+ * @param cache The cached field
+ * @param iso_value The iso value of the contour
+ * @param tiles Output, the ranges of tiles per tile column
+ */
+void MarchingSquaresBase::select_tiles(const FieldCache& cache, const double iso_value, Workspace::ActiveTiles& tiles) const
+{
+    const auto candidates = static_cast<size_t>(std::upper_bound(cache.sorted_min.begin(), cache.sorted_min.end(), iso_value) -
+                                                cache.sorted_min.begin());
+
+    tiles.selected.clear();
+
+    for (size_t k = 0; k < candidates; ++k)
+    {
+        const auto tile = cache.tiles_by_min[k];
+
+        if (cache.tile_max[tile] >= iso_value)
+            tiles.selected.push_back(tile);
+    }
+
+    group_tiles(cache.major_tiles, cache.minor_tiles, tiles);
+}
+
+/**
+ * Groups the selected tiles into ranges per tile column
+ *
+ * @param major_tiles The number of tiles along the major axis
+ * @param minor_tiles The number of tiles along the minor axis
+ * @param tiles The tiles, selected holds the tile indices I * minor_tiles + J, in any order
+ */
+void MarchingSquaresBase::group_tiles(const size_t major_tiles, const size_t minor_tiles, Workspace::ActiveTiles& tiles) const
+{
+    const auto& selected = tiles.selected;
+    auto& cursor = tiles.cursor;
+    auto& minor = tiles.minor_tiles;
+
+    // Bucket the tiles by their tile column
+    cursor.assign(major_tiles + 1, 0);
+
+    for (const auto tile : selected)
+        ++cursor[tile / minor_tiles + 1];
+
+    for (size_t I = 0; I < major_tiles; ++I)
+        cursor[I + 1] += cursor[I];
+
+    tiles.range_offsets.assign(major_tiles + 1, 0);
+    tiles.ranges.clear();
+    minor.resize(selected.size());
+
+    for (const auto tile : selected)
+        minor[cursor[tile / minor_tiles]++] = static_cast<uint32_t>(tile % minor_tiles);
+
+    // The cursors now point to the end of their bucket, merge neighbouring tiles into ranges
+    size_t begin = 0;
+    for (size_t I = 0; I < major_tiles; ++I)
+    {
+        const auto end = cursor[I];
+        std::sort(minor.begin() + begin, minor.begin() + end);
+
+        tiles.range_offsets[I] = tiles.ranges.size();
+
+        for (auto k = begin; k < end; ++k)
+        {
+            const auto J = minor[k];
+
+            if (tiles.ranges.size() > tiles.range_offsets[I] && tiles.ranges.back()[1] == J)
+                tiles.ranges.back()[1] = J + 1;
+            else
+                tiles.ranges.push_back({ J, J + 1 });
+        }
+
+        begin = end;
+    }
+    tiles.range_offsets[major_tiles] = tiles.ranges.size();
+}
+
+/**
+ * Finds the tiles the contours may pass through from the bounds of the field
+ *
+ * Starting from the whole grid, the blocks whose bound excludes every iso
+ * value are dropped, the others are split in two along their longer side
+ * down to single tiles. Every level keeps the tiles whose bound contains
+ * its iso value, and the tiles kept for any level are the ones to sample.
+ * A dropped tile has all its nodes strictly on one side of the iso values,
+ * so none of its cells has a vertex
+ *
+ * @param iso_values The iso values to compute the contours for
+ * @param level_count The number of iso values
+ * @param workspace The workspace, receives the tiles per level and the ones to sample
+ *
+ * @return false if the field has no bounds or no tile could be dropped, the whole grid is swept then
+ */
+bool MarchingSquaresBase::cull_tiles(const double* iso_values, const size_t level_count, Workspace& workspace) const
+{
+    const auto major_tiles = (nx1_ + tile_cells_ - 1) / tile_cells_;
+    const auto minor_tiles = (nx2_ + tile_cells_ - 1) / tile_cells_;
+
+    // Bounds the nodes of the tiles [I0, I1) x [J0, J1)
+    const auto bound = [this](const std::array<size_t, 4>& block, Limits& range)
+    {
+        const auto i0 = block[0] * tile_cells_;
+        const auto i1 = std::min(block[1] * tile_cells_, nx1_);
+        const auto j0 = block[2] * tile_cells_;
+        const auto j1 = std::min(block[3] * tile_cells_, nx2_);
+
+        return x_major_ ? field_->value_range(i0, j0, i1, j1, range) : field_->value_range(j0, i0, j1, i1, range);
+    };
+
+    // NaN bounds and iso values rule nothing out
+    const auto contains = [](const Limits& range, const double iso_value)
+    {
+        return !(iso_value < range[0] || iso_value > range[1]);
+    };
+
+    auto& kept = workspace.bounded_tiles_;
+    auto& pending = workspace.pending_blocks_;
+
+    kept.clear();
+    pending.assign(1, { 0, major_tiles, 0, minor_tiles });
+
+    while (!pending.empty())
+    {
+        const auto block = pending.back();
+        pending.pop_back();
+
+        Limits range;
+        if (!bound(block, range))
+            return false;
+
+        if (std::none_of(iso_values, iso_values + level_count, [&](const double iso_value) { return contains(range, iso_value); }))
+            continue;
+
+        const auto major = block[1] - block[0];
+        const auto minor = block[3] - block[2];
+
+        if (major == 1 && minor == 1)
+            kept.emplace_back(static_cast<uint32_t>(block[0] * minor_tiles + block[2]), range);
+        else if (major >= minor)
+        {
+            pending.push_back({ block[0], block[0] + major / 2, block[2], block[3] });
+            pending.push_back({ block[0] + major / 2, block[1], block[2], block[3] });
+        }
+        else
+        {
+            pending.push_back({ block[0], block[1], block[2], block[2] + minor / 2 });
+            pending.push_back({ block[0], block[1], block[2] + minor / 2, block[3] });
+        }
+    }
+
+    if (kept.size() == major_tiles * minor_tiles)
+        return false;
+
+    workspace.active_tiles_.resize(level_count + 1);
+
+    for (size_t l = 0; l <= level_count; ++l)
+    {
+        auto& tiles = workspace.active_tiles_[l];
+        tiles.selected.clear();
+
+        for (const auto& tile : kept)
+            if (l == level_count || contains(tile.second, iso_values[l]))
+                tiles.selected.push_back(tile.first);
+
+        group_tiles(major_tiles, minor_tiles, tiles);
+    }
+
+    return true;
+}
+
+/**
+ * Sweeps the strips of the grid for the given levels, without stitching them
+ *
+ * @param iso_values The iso values to compute the contours for
+ * @param level_count The number of iso values, at least one
+ * @param workspace The workspace to use, it holds the swept strips afterwards
+ * @param thread_pool The pool to sweep on, null to do it on the calling thread
+ * @param progress Optional, receives the swept columns, the sweep throws ComputeCancelled once it asks to stop
+ * @param max_strip_columns The most major axis cells of a strip, 0 for no limit
+ */
+void MarchingSquaresBase::sweep_strips(const double* iso_values,
+                                       const size_t level_count,
+                                       Workspace& workspace,
+                                       ThreadPool* thread_pool,
+                                       ComputeProgress* progress,
+                                       const size_t max_strip_columns) const
+{
+    // Hold on to the cache, it may be replaced meanwhile
+    const auto field_cache = std::atomic_load(&field_cache_);
+
+    const auto culled = !field_cache && cull_tiles(iso_values, level_count, workspace);
+
+    if (field_cache)
+    {
+        workspace.active_tiles_.resize(level_count);
+
+        for (size_t l = 0; l < level_count; ++l)
+            select_tiles(*field_cache, iso_values[l], workspace.active_tiles_[l]);
+    }
+
+    // Split the major axis into strips, every strip is at least one cell wide
+    auto strip_count = thread_pool ? std::min(nx1_, (thread_pool->size() + 1) * strips_per_thread_) : 1;
+
+    if (max_strip_columns > 0)
+        strip_count = std::max(strip_count, (nx1_ + max_strip_columns - 1) / max_strip_columns);
+
+    auto& strips = workspace.strips_;
+    strips.resize(strip_count);
+
+    for (size_t k = 0; k < strip_count; ++k)
+    {
+        strips[k].begin = nx1_ * k / strip_count;
+        strips[k].end = nx1_ * (k + 1) / strip_count;
+        strips[k].field_values = field_cache ? field_cache->values.data() : nullptr;
+        strips[k].sampled_tiles = culled ? &workspace.active_tiles_[level_count] : nullptr;
+        strips[k].progress = progress;
+        strips[k].levels.resize(level_count);
+
+        for (size_t l = 0; l < level_count; ++l)
+        {
+            strips[k].levels[l].iso_value = iso_values[l];
+            strips[k].levels[l].tiles = field_cache || culled ? &workspace.active_tiles_[l] : nullptr;
+        }
+    }
+
+    if (thread_pool)
+    {
+        thread_pool->parallel_for(strip_count, [&](const size_t k)
+        {
+            sweep_strip(strips[k]);
+        });
+    }
+    else
+        for (auto& strip : strips)
+            sweep_strip(strip);
+
+    // The strips stopped early, so what they hold is no contour
+    if (progress && progress->cancel_requested.load())
+        throw ComputeCancelled();
+}
+
+/**
+ * Sweeps the grid for the given levels, leaving the result in the workspace
+ *
+ * @param iso_values The iso values to compute the contours for
+ * @param level_count The number of iso values
+ * @param workspace The workspace to use
+ * @param progress Optional, receives the swept columns, the sweep throws ComputeCancelled once it asks to stop
+ */
+void MarchingSquaresBase::sweep(const double* iso_values, const size_t level_count, Workspace& workspace, ComputeProgress* progress) const
+{
+    if (progress)
+        progress->total_columns = nx1_;
+
+    // The strips are about to be overwritten
+    workspace.output_pending_ = false;
+
+    if (level_count == 0)
+    {
+        workspace.vertices_.clear();
+        workspace.indices_.clear();
+        workspace.offsets_.assign(1, { 0, 0 });
+        workspace.stats_ = ComputeStats();
+
+        return;
+    }
+
+    // Hold on to the pool, it may be replaced meanwhile
+    const auto thread_pool = thread_pool_.pool();
+
+    sweep_strips(iso_values, level_count, workspace, thread_pool.get(), progress, 0);
+
+    workspace.stats_ = ComputeStats();
+    MARCHING_SQUARES_STAT(auto clock = std::chrono::steady_clock::now();)
+
+    stitch_strips(workspace, thread_pool.get());
+
+    MARCHING_SQUARES_STAT(
+        workspace.stats_.stitch_seconds = Lap(clock);
+        gather_stats(workspace, workspace.vertices_.size());
+    )
+}
+
+/**
+ * Sweeps the grid for the given levels and writes the result into caller owned memory
+ *
+ * @param iso_values The iso values to compute the contours for
+ * @param level_count The number of iso values
+ * @param workspace The workspace to use, it keeps what does not fit
+ * @param buffers The memory to write to
+ *
+ * @return How much was written and how much is left
+ */
+OutputStatus MarchingSquaresBase::sweep_into(const double* iso_values,
+                                             const size_t level_count,
+                                             Workspace& workspace,
+                                             const OutputBuffers& buffers) const
+{
+    if ((!buffers.vertices && buffers.vertex_capacity > 0) || (!buffers.indices && buffers.index_capacity > 0))
+        throw std::invalid_argument("MarchingSquares::compute_into: A buffer with a capacity needs memory");
+
+    workspace.output_pending_ = false;
+    workspace.stats_ = ComputeStats();
+
+    if (level_count == 0)
+    {
+        workspace.part_offsets_.assign(1, { 0, 0 });
+        workspace.offsets_.assign(1, { 0, 0 });
+        workspace.written_ = { 0, 0 };
+
+        return OutputStatus();
+    }
+
+    const auto thread_pool = thread_pool_.pool();
+
+    sweep_strips(iso_values, level_count, workspace, thread_pool.get(), nullptr, 0);
+    plan_output(workspace);
+
+    MARCHING_SQUARES_STAT(gather_stats(workspace, workspace.offsets_.back()[0]);)
+
+    workspace.output_pending_ = true;
+
+    return write_remaining(workspace, buffers);
+}
+
+/**
+ * Adds the counters of the strips to the ones of the workspace
+ *
+ * @param workspace The workspace holding the swept strips
+ * @param vertex_count The number of vertices of the result
+ */
+void MarchingSquaresBase::gather_stats(Workspace& workspace, const size_t vertex_count) const
+{
+    auto& stats = workspace.stats_;
+
+    for (const auto& strip : workspace.strips_)
+    {
+        stats += strip.stats;
+        for (const auto& level : strip.levels)
+            stats += level.stats;
+    }
+
+    // Every vertex of the result sits on one crossed edge
+    stats.crossing_edges = vertex_count;
+}
+
+// In order to store minimum number of calculations, we play smart
+// We will return a vertex array object and an element index buffer
+std::tuple<VerticesList, IndicesList> MarchingSquaresBase::compute_faster(const double iso_value) const
+{
+    Workspace workspace;
+    compute_faster(iso_value, workspace);
+
+    return { std::move(workspace.vertices_), std::move(workspace.indices_) };
+}
+
+/**
+ * Computes the contour into a workspace that can be reused by later calls
+ *
+ * @param iso_value The iso value of the contour
+ * @param workspace The workspace to use, it holds the result afterwards
+ */
+void MarchingSquaresBase::compute_faster(const double iso_value, Workspace& workspace) const
+{
+    sweep(&iso_value, 1, workspace);
+}
+
+/**
+ * Bounds the size of a contour without sampling the field
+ *
+ * Every vertex sits on a distinct edge and every cell holds at most two
+ * segments. With field caching enabled, only the tiles whose value range
+ * contains the iso value are counted, otherwise the whole grid. When the
+ * contour is known to be close to the last one, sizing the buffers after
+ * it and resuming with write_remaining wastes less memory
+ *
+ * @param iso_value The iso value of the contour
+ *
+ * @return The most vertices and indices the contour can have
+ */
+OutputBounds MarchingSquaresBase::estimate_output(const double iso_value) const
+{
+    const auto bound = [](const size_t major_cells, const size_t minor_cells)
+    {
+        OutputBounds bounds;
+        bounds.vertices = major_cells * (minor_cells + 1) + minor_cells * (major_cells + 1);
+        bounds.indices = 2 * major_cells * minor_cells;
+
+        return bounds;
+    };
+
+    const auto grid_bounds = bound(nx1_, nx2_);
+    const auto field_cache = std::atomic_load(&field_cache_);
+
+    if (!field_cache)
+        return grid_bounds;
+
+    const auto& cache = *field_cache;
+    const auto candidates = static_cast<size_t>(std::upper_bound(cache.sorted_min.begin(), cache.sorted_min.end(), iso_value) -
+                                                cache.sorted_min.begin());
+
+    // Edges shared by two tiles are counted by both, which only loosens the bound
+    OutputBounds bounds;
+    for (size_t k = 0; k < candidates; ++k)
+    {
+        const auto tile = cache.tiles_by_min[k];
+
+        if (cache.tile_max[tile] >= iso_value)
+        {
+            const auto I = tile / cache.minor_tiles;
+            const auto J = tile % cache.minor_tiles;
+            const auto tile_bounds = bound(std::min(tile_cells_, nx1_ - I * tile_cells_), std::min(tile_cells_, nx2_ - J * tile_cells_));
+
+            bounds.vertices += tile_bounds.vertices;
+            bounds.indices += tile_bounds.indices;
+        }
+    }
+
+    bounds.vertices = std::min(bounds.vertices, grid_bounds.vertices);
+    bounds.indices = std::min(bounds.indices, grid_bounds.indices);
+
+    return bounds;
+}
+
+/**
+ * Computes the contour into memory owned by the caller
+ *
+ * The vertices and indices are written from the start of their buffers,
+ * as many as fit. The rest stays in the workspace until write_remaining
+ * hands it out, the workspace must not be used for anything else
+ * meanwhile. The result is the same as the one of compute_faster
+ *
+ * @param iso_value The iso value of the contour
+ * @param workspace The workspace to use, reusing it avoids allocations
+ * @param buffers The memory to write to, see estimate_output for its size
+ *
+ * @return How much was written and how much is left
+ */
+OutputStatus MarchingSquaresBase::compute_into(const double iso_value, Workspace& workspace, const OutputBuffers& buffers) const
+{
+    return sweep_into(&iso_value, 1, workspace, buffers);
+}
+
+/**
+ * Computes the contours of several iso values into memory owned by the caller
+ *
+ * Like compute_into, with the levels one after the other. Where each level
+ * starts is in the offsets of the workspace
+ *
+ * @param iso_values The iso values to compute the contours for
+ * @param workspace The workspace to use, reusing it avoids allocations
+ * @param buffers The memory to write to
+ *
+ * @return How much was written and how much is left
+ */
+OutputStatus MarchingSquaresBase::compute_levels_into(const std::vector<double>& iso_values,
+                                                      Workspace& workspace,
+                                                      const OutputBuffers& buffers) const
+{
+    return sweep_into(iso_values.data(), iso_values.size(), workspace, buffers);
+}
+
+/**
+ * Writes the part of a contour that did not fit into the previous buffers
+ *
+ * The buffers are filled from their start again. The indices still count
+ * from the first vertex of the whole contour, so the pieces concatenate
+ *
+ * @param workspace The workspace of the compute_into call
+ * @param buffers The memory to write to
+ *
+ * @return How much was written and how much is left
+ */
+OutputStatus MarchingSquaresBase::write_remaining(Workspace& workspace, const OutputBuffers& buffers) const
+{
+    if (!workspace.output_pending_)
+        throw std::logic_error("MarchingSquares::write_remaining: The workspace holds no output to write");
+    if ((!buffers.vertices && buffers.vertex_capacity > 0) || (!buffers.indices && buffers.index_capacity > 0))
+        throw std::invalid_argument("MarchingSquares::write_remaining: A buffer with a capacity needs memory");
+
+    const auto thread_pool = thread_pool_.pool();
+    const auto written = write_parts(workspace, buffers, thread_pool.get());
+
+    OutputStatus status;
+    status.vertices_written = written[0];
+    status.indices_written = written[1];
+    status.vertices_remaining = workspace.part_offsets_.back()[0] - workspace.written_[0];
+    status.indices_remaining = workspace.part_offsets_.back()[1] - workspace.written_[1];
+
+    workspace.output_pending_ = !status.complete();
+
+    return status;
+}
+
+/**
+ * Computes the contour with its vertices converted to another format
+ *
+ * The vertices are converted while the strips are merged, the contour is
+ * never held as one list in double precision
+ *
+ * @param iso_value The iso value of the contour
+ * @param convert Maps a Point2D to an element of Vertices
+ *
+ * @return The converted vertices and the indices
+ */
+template <typename Vertices, typename Convert>
+std::tuple<Vertices, IndicesList> MarchingSquaresBase::compute_faster_as(const double iso_value, const Convert& convert) const
+{
+    Workspace workspace;
+
+    // Hold on to the pool, it may be replaced meanwhile
+    const auto thread_pool = thread_pool_.pool();
+
+    sweep_strips(&iso_value, 1, workspace, thread_pool.get(), nullptr, 0);
+    plan_output(workspace);
+
+    Vertices vertices(workspace.offsets_.back()[0]);
+    IndicesList indices;
+
+    // A single strip needs no remapping, its indices are the result already
+    if (workspace.strips_.size() == 1)
+    {
+        indices.swap(workspace.strips_.front().levels.front().indices);
+        write_parts(workspace, vertices.data(), vertices.size(), indices.data(), 0, convert, thread_pool.get());
+    }
+    else
+    {
+        indices.resize(workspace.offsets_.back()[1]);
+        write_parts(workspace, vertices.data(), vertices.size(), indices.data(), indices.size(), convert, thread_pool.get());
+    }
+
+    return std::make_tuple(std::move(vertices), std::move(indices));
+}
+
+/**
+ * Computes the contour with single precision vertices
+ *
+ * @param iso_value The iso value of the contour
+ *
+ * @return The vertices and the indices, the same as compute_faster up to rounding
+ */
+std::tuple<VerticesListF, IndicesList> MarchingSquaresBase::compute_faster_float(const double iso_value) const
+{
+    return compute_faster_as<VerticesListF>(iso_value, [](const Point2D& vertex)
+    {
+        return std::array<float, 2>{ static_cast<float>(vertex[0]), static_cast<float>(vertex[1]) };
+    });
+}
+
+/**
+ * Computes the contour with vertices quantized to 16 bits relative to the limits
+ *
+ * DequantizeVertices with the same limits maps them back to coordinates
+ *
+ * @param iso_value The iso value of the contour
+ *
+ * @return The quantized vertices and the indices
+ */
+std::tuple<QuantizedVerticesList, IndicesList> MarchingSquaresBase::compute_faster_quantized(const double iso_value) const
+{
+    const auto x_scale = QuantizationSteps / (x_limits_[1] - x_limits_[0]);
+    const auto y_scale = QuantizationSteps / (y_limits_[1] - y_limits_[0]);
+
+    return compute_faster_as<QuantizedVerticesList>(iso_value, [this, x_scale, y_scale](const Point2D& vertex)
+    {
+        return std::array<uint16_t, 2>{ Quantize(vertex[0], x_limits_[0], x_scale), Quantize(vertex[1], y_limits_[0], y_scale) };
+    });
+}
+
+/**
+ * Computes the contour as polylines instead of separate segments
+ *
+ * @param iso_value The iso value of the contour
+ *
+ * @return The vertices and the polylines made of them
+ */
+std::tuple<VerticesList, Polylines> MarchingSquaresBase::compute_polylines(const double iso_value) const
+{
+    Workspace workspace;
+    compute_faster(iso_value, workspace);
+
+    auto polylines = AssemblePolylines(workspace.indices_, workspace.vertices_.size());
+
+    return std::make_tuple(std::move(workspace.vertices_), std::move(polylines));
+}
+
+/**
+ * Computes the contour and hands it to a sink in chunks of major axis columns
+ *
+ * The grid is swept on the calling thread and the sink is called after
+ * every chunk_columns columns of cells. Only the current chunk is held in
+ * memory, so the peak memory depends on the chunk size and not on the size
+ * of the whole contour. The chunk buffers are reused for the next chunk,
+ * unless the sink moves them out
+ *
+ * With global indexing, the chunks put one after the other are the same as
+ * the result of compute_faster. With local indexing, every chunk can be used
+ * on its own, the vertices on the column between two chunks are sent twice
+ *
+ * @param iso_value The iso value of the contour
+ * @param chunk_columns The number of major axis cells per chunk, 0 sends a single chunk
+ * @param sink The function receiving the chunks, in major axis order
+ * @param indexing Whether the indices refer to all the vertices sent so far or to the chunk only
+ */
+void MarchingSquaresBase::compute_streaming(const double iso_value,
+                                            const size_t chunk_columns,
+                                            const ChunkSink& sink,
+                                            const ChunkIndexing indexing) const
+{
+    const auto columns = chunk_columns > 0 ? chunk_columns : nx1_;
+
+    Strip strip;
+    strip.begin = 0;
+    strip.end = nx1_;
+    strip.levels.resize(1);
+    strip.levels.front().iso_value = iso_value;
+
+    auto& level = strip.levels.front();
+    auto& last_col_func = strip.last_col_func;
+    auto& cur_col_func = strip.cur_col_func;
+
+    const std::array<uint32_t, 2> all_cells = { 0, static_cast<uint32_t>(MaskWords(nx2_)) };
+    ContourChunk chunk;
+
+    start_strip(strip);
+
+    for (size_t i = 1; i <= nx1_; ++i)
+    {
+        sample_column(i, cur_col_func, strip.scratch);
+        sweep_column(level, last_col_func.data(), cur_col_func.data(), i, &all_cells, 1);
+        last_col_func.swap(cur_col_func);
+
+        if (i % columns != 0 && i != nx1_)
+            continue;
+
+        if (level.vertex_base + level.vertices.size() > MaxIndexedVertices)
+        {
+            throw std::length_error("MarchingSquares::compute_streaming: The indices exceed 32 bits, "
+                                    "use local indexing with fewer columns per chunk");
+        }
+
+        chunk.first_column = chunk.last_column;
+        chunk.last_column = i;
+        chunk.vertex_offset = level.vertex_base;
+
+        // The sink may move the buffers out, count the vertices first
+        if (indexing == ChunkIndexing::Global)
+            level.vertex_base += level.vertices.size();
+
+        // Lend the level's buffers to the sink, they come back empty or as they were
+        chunk.vertices.swap(level.vertices);
+        chunk.indices.swap(level.indices);
+
+        sink(chunk);
+
+        chunk.vertices.swap(level.vertices);
+        chunk.indices.swap(level.indices);
+
+        level.vertices.clear();
+        level.indices.clear();
+
+        // The next chunk starts with its own copy of the vertices on the border column
+        if (indexing == ChunkIndexing::Local && i != nx1_)
+        {
+            level.vertex_base = 0;
+            seed_column(level, last_col_func.data(), i);
+        }
+    }
+}
+
+/**
+ * Computes the contour split into chunks that 32 bit indices can address
+ *
+ * The major axis is cut into strips narrow enough that none of them can
+ * have more than max_chunk_vertices vertices, and neighbouring strips are
+ * merged into chunks as long as they fit. The indices of a chunk refer to
+ * its own vertices. A chunk starts with its own copy of the vertices on
+ * the column it shares with the previous chunk, otherwise the chunks
+ * hold the same vertices and segments as compute_faster
+ *
+ * @param iso_value The iso value of the contour
+ * @param max_chunk_vertices The most vertices of a chunk, at most MaxIndexedVertices
+ *
+ * @return The chunks in major axis order, vertex_offset counts the vertices of the chunks before
+ */
+std::vector<ContourChunk> MarchingSquaresBase::compute_chunked(const double iso_value, const size_t max_chunk_vertices) const
+{
+    // A column of cells crosses at most all its edges, a strip adds the ones of its first column
+    const auto column_vertices = 2 * nx2_ + 1;
+
+    if (max_chunk_vertices > MaxIndexedVertices)
+        throw std::invalid_argument("MarchingSquares::compute_chunked: 32 bit indices can not address that many vertices");
+    if (max_chunk_vertices < nx2_ + column_vertices)
+        throw std::invalid_argument("MarchingSquares::compute_chunked: A chunk must hold the vertices of at least one column of cells");
+
+    Workspace workspace;
+    const auto thread_pool = thread_pool_.pool();
+
+    sweep_strips(&iso_value, 1, workspace, thread_pool.get(), nullptr, (max_chunk_vertices - nx2_) / column_vertices);
+
+    const auto& strips = workspace.strips_;
+
+    // Merge strips while the chunk fits, the first strip of a chunk keeps its seam vertices
+    std::vector<std::array<size_t, 2>> ranges;
+    for (size_t first = 0; first < strips.size();)
+    {
+        auto vertex_count = strips[first].levels.front().vertices.size();
+        auto last = first + 1;
+
+        while (last < strips.size())
+        {
+            const auto& level = strips[last].levels.front();
+            const auto added = level.vertices.size() - level.seam_vertices;
+
+            if (vertex_count + added > max_chunk_vertices)
+                break;
+
+            vertex_count += added;
+            ++last;
+        }
+
+        ranges.push_back({ first, last });
+        first = last;
+    }
+
+    std::vector<ContourChunk> chunks(ranges.size());
+
+    const auto build = [&](const size_t c)
+    {
+        build_chunk(workspace, ranges[c][0], ranges[c][1], chunks[c]);
+    };
+
+    if (thread_pool)
+        thread_pool->parallel_for(chunks.size(), build);
+    else
+        for (size_t c = 0; c < chunks.size(); ++c)
+            build(c);
+
+    for (size_t c = 1; c < chunks.size(); ++c)
+        chunks[c].vertex_offset = chunks[c - 1].vertex_offset + chunks[c - 1].vertices.size();
+
+    return chunks;
+}
+
+/**
+ * Merges a range of swept strips into a chunk with its own indices
+ *
+ * Works like stitch_strips, except that the first strip keeps the vertices
+ * on its first column instead of referring to the previous strip
+ *
+ * @param workspace The workspace holding the swept strips, with a single level
+ * @param first_strip The first strip of the chunk
+ * @param last_strip One past the last strip of the chunk
+ * @param chunk Output, receives the columns, vertices and indices
+ */
+void MarchingSquaresBase::build_chunk(const Workspace& workspace,
+                                      const size_t first_strip,
+                                      const size_t last_strip,
+                                      ContourChunk& chunk) const
+{
+    const auto& strips = workspace.strips_;
+
+    chunk.first_column = strips[first_strip].begin;
+    chunk.last_column = strips[last_strip - 1].end;
+
+    size_t vertex_count = 0, index_count = 0;
+    for (auto k = first_strip; k < last_strip; ++k)
+    {
+        const auto& level = strips[k].levels.front();
+
+        vertex_count += level.vertices.size() - (k > first_strip ? level.seam_vertices : 0);
+        index_count += level.indices.size();
+    }
+
+    chunk.vertices.reserve(vertex_count);
+    chunk.indices.reserve(index_count);
+
+    std::vector<uint32_t> seam_map;
+
+    // Chunk index of the first vertex of the previous strip
+    size_t previous_offset = 0;
+
+    for (auto k = first_strip; k < last_strip; ++k)
+    {
+        const auto& level = strips[k].levels.front();
+        const auto seam = k > first_strip ? level.seam_vertices : 0;
+        const auto offset = chunk.vertices.size();
+
+        // Redirect the seam vertices to the last column of the previous strip
+        seam_map.assign(seam, NoVertex);
+        if (seam > 0)
+        {
+            const auto& previous = strips[k - 1].levels.front();
+
+            for (size_t j = 0; j < nx2_; ++j)
+            {
+                const auto local = level.first_index_map[j];
+
+                if (local != NoVertex)
+                    seam_map[local] = static_cast<uint32_t>(previous_offset + previous.last_index_map[j]);
+            }
+        }
+
+        chunk.vertices.insert(chunk.vertices.end(), level.vertices.begin() + seam, level.vertices.end());
+
+        const auto remap = [&](const uint32_t local)
+        {
+            return local < seam ? seam_map[local] : static_cast<uint32_t>(offset + local - seam);
+        };
+
+        for (const auto& edge : level.indices)
+            chunk.indices.push_back({ remap(edge[0]), remap(edge[1]) });
+
+        // The previous strip's indices count its dropped seam vertices as well
+        previous_offset = offset - seam;
+    }
+}
+
+/**
+ * The state of an adaptive computation
+ *
+ * Nodes, vertices and visited cells are stored by their linear index,
+ * so only the refined part of the grid takes up memory
+ */
+struct MarchingSquaresBase::AdaptiveState
+{
+    double iso_value = 0;
+    double tolerance = 0;
+
+    // Function values of the nodes sampled so far
+    std::unordered_map<uint64_t, double> node_values;
+
+    // Vertex index per edge, the edge key is twice the key of its first node, plus one along the major axis
+    std::unordered_map<uint64_t, uint32_t> edge_vertices;
+
+    std::unordered_set<uint64_t> visited_cells;
+    std::vector<std::array<size_t, 2>> pending_cells;
+
+    VerticesList vertices;
+    IndicesList indices;
+};
+
+/**
+ * Returns the function value of a node, sampling it on first use
+ *
+ * @param state The adaptive state holding the sampled nodes
+ * @param i The node index along the major axis
+ * @param j The node index along the minor axis
+ */
+double MarchingSquaresBase::adaptive_value(AdaptiveState& state, const size_t i, const size_t j) const
+{
+    const auto key = static_cast<uint64_t>(i) * (nx2_ + 1) + j;
+    const auto found = state.node_values.find(key);
+
+    if (found != state.node_values.end())
+        return found->second;
+
+    const auto value = x_major_ ? field_->value(i, j) : field_->value(j, i);
+    state.node_values.emplace(key, value);
+
+    return value;
+}
+
+/**
+ * Splits a block of cells until it is a single cell or holds no contour
+ *
+ * A block is refined unless all of its corners are more than the tolerance
+ * above or below the iso value. Single cells that are refined seed the
+ * contour following
+ *
+ * @param state The adaptive state
+ * @param i0, i1 The first and last node of the block along the major axis
+ * @param j0, j1 The first and last node of the block along the minor axis
+ */
+void MarchingSquaresBase::refine_block(AdaptiveState& state, const size_t i0, const size_t i1, const size_t j0, const size_t j1) const
+{
+    const double corners[4] = {
+        adaptive_value(state, i0, j0),
+        adaptive_value(state, i1, j0),
+        adaptive_value(state, i1, j1),
+        adaptive_value(state, i0, j1)
+    };
+
+    bool above = true, below = true;
+    for (const auto value : corners)
+    {
+        above = above && value > state.iso_value + state.tolerance;
+        below = below && value < state.iso_value - state.tolerance;
+    }
+
+    if (above || below)
+        return;
+
+    if (i1 - i0 == 1 && j1 - j0 == 1)
+    {
+        state.pending_cells.push_back({ i0, j0 });
+        return;
+    }
+
+    // Halve the sides longer than one cell
+    const auto im = i1 - i0 > 1 ? (i0 + i1) / 2 : i1;
+    const auto jm = j1 - j0 > 1 ? (j0 + j1) / 2 : j1;
+
+    refine_block(state, i0, im, j0, jm);
+    if (jm != j1)
+        refine_block(state, i0, im, jm, j1);
+    if (im != i1)
+    {
+        refine_block(state, im, i1, j0, jm);
+        if (jm != j1)
+            refine_block(state, im, i1, jm, j1);
+    }
+}
+
+/**
+ * Returns the index of the vertex on an edge of a cell, adding it on first use
+ *
+ * @param state The adaptive state
+ * @param i, j The first node of the edge
+ * @param along_major Whether the edge goes to (i + 1, j) instead of (i, j + 1)
+ */
+uint32_t MarchingSquaresBase::adaptive_vertex(AdaptiveState& state, const size_t i, const size_t j, const bool along_major) const
+{
+    const auto key = (static_cast<uint64_t>(i) * (nx2_ + 1) + j) * 2 + along_major;
+    const auto found = state.edge_vertices.find(key);
+
+    if (found != state.edge_vertices.end())
+        return found->second;
+
+    if (state.vertices.size() >= MaxIndexedVertices)
+        throw std::length_error("MarchingSquares::compute_adaptive: The contour has more vertices than 32 bit indices can address");
+
+    const auto index = static_cast<uint32_t>(state.vertices.size());
+    const auto i1 = along_major ? i + 1 : i;
+    const auto j1 = along_major ? j : j + 1;
+
+    // Same orientation as the sweep, so the vertices are bit identical
+    state.vertices.emplace_back(LinearInterpolate(node_point(i, j),
+        node_point(i1, j1),
+        { adaptive_value(state, i, j), adaptive_value(state, i1, j1) },
+        state.iso_value));
+    state.edge_vertices.emplace(key, index);
+
+    return index;
+}
+
+/**
+ * Emits the contour of a single cell and queues the neighbours the contour passes on to
+ *
+ * @param state The adaptive state
+ * @param i, j The lower node of the cell
+ */
+void MarchingSquaresBase::follow_cell(AdaptiveState& state, const size_t i, const size_t j) const
+{
+    const auto iso_value = state.iso_value;
+
+    // Check the cells case, in the order (Node0, Node1, Node2, Node3)
+    const auto key = static_cast<size_t>(adaptive_value(state, i, j) > iso_value) << 3 |
+                     static_cast<size_t>(adaptive_value(state, i + 1, j) > iso_value) << 2 |
+                     static_cast<size_t>(adaptive_value(state, i + 1, j + 1) > iso_value) << 1 |
+                     static_cast<size_t>(adaptive_value(state, i, j + 1) > iso_value);
+
+    const auto& intersected_edges = case_to_edges(key);
+
+    uint32_t edge_index[4];
+    for (const auto edge : intersected_edges)
+    {
+        switch (edge)
+        {
+        case 0:
+            edge_index[0] = adaptive_vertex(state, i, j, true);
+            if (j > 0)
+                state.pending_cells.push_back({ i, j - 1 });
+            break;
+        case 1:
+            edge_index[1] = adaptive_vertex(state, i + 1, j, false);
+            if (i + 1 < nx1_)
+                state.pending_cells.push_back({ i + 1, j });
+            break;
+        case 2:
+            edge_index[2] = adaptive_vertex(state, i, j + 1, true);
+            if (j + 1 < nx2_)
+                state.pending_cells.push_back({ i, j + 1 });
+            break;
+        default:
+            edge_index[3] = adaptive_vertex(state, i, j, false);
+            if (i > 0)
+                state.pending_cells.push_back({ i - 1, j });
+            break;
+        }
+    }
+
+    auto& indices = state.indices;
+
+    if (intersected_edges.size() == 2)
+    {
+        indices.push_back({ edge_index[intersected_edges[0]], edge_index[intersected_edges[1]] });
+    }
+    // Ambiguous cases, resolved like the sweep does
+    else if (intersected_edges.size() == 4)
+    {
+        if (state.vertices[edge_index[0]][0] > state.vertices[edge_index[2]][0])
+        {
+            indices.push_back({ edge_index[intersected_edges[0]], edge_index[intersected_edges[1]] });
+            indices.push_back({ edge_index[intersected_edges[2]], edge_index[intersected_edges[3]] });
+        }
+        else
+        {
+            indices.push_back({ edge_index[intersected_edges[0]], edge_index[intersected_edges[3]] });
+            indices.push_back({ edge_index[intersected_edges[1]], edge_index[intersected_edges[2]] });
+        }
+    }
+}
+
+/**
+ * Computes the contour by refining a coarse grid only where it is needed
+ *
+ * The grid is first sampled every coarse_step cells. Blocks whose corners
+ * are not all above or all below the iso value, give or take the tolerance,
+ * are split down to single cells. From these cells the contour is followed
+ * through the full resolution grid, so every contour that is found is
+ * traced completely and the result has no cracks. Its edges are the same as
+ * the ones of compute_faster, in a different order
+ *
+ * A contour that lies inside a block without touching the tolerance band at
+ * its corners is not found. A larger tolerance or a smaller step makes small
+ * features safer to find, at the cost of more function evaluations
+ *
+ * @param iso_value The iso value of the contour
+ * @param coarse_step The number of cells per coarse block along each axis
+ * @param tolerance Blocks with a corner within this distance of the iso value are refined
+ *
+ * @return The vertices and the indices of the contour
+ */
+std::tuple<VerticesList, IndicesList> MarchingSquaresBase::compute_adaptive(const double iso_value,
+                                                                            const size_t coarse_step,
+                                                                            const double tolerance) const
+{
+    const auto step = std::max<size_t>(coarse_step, 1);
+
+    AdaptiveState state;
+    state.iso_value = iso_value;
+    state.tolerance = tolerance;
+
+    for (size_t i = 0; i < nx1_; i += step)
+        for (size_t j = 0; j < nx2_; j += step)
+            refine_block(state, i, std::min(i + step, nx1_), j, std::min(j + step, nx2_));
+
+    // Follow the contour from the refined cells through all the cells it crosses
+    while (!state.pending_cells.empty())
+    {
+        const auto cell = state.pending_cells.back();
+        state.pending_cells.pop_back();
+
+        if (state.visited_cells.insert(static_cast<uint64_t>(cell[0]) * nx2_ + cell[1]).second)
+            follow_cell(state, cell[0], cell[1]);
+    }
+
+    return std::make_tuple(std::move(state.vertices), std::move(state.indices));
+}
+
+/**
+ * Computes the contour of a field that changed a little since the last step
+ *
+ * The active cells of the previous step, grown by band cells in every
+ * direction, are checked for the contour. From the cells it crosses, the
+ * contour is followed cell by cell like compute_adaptive does, so it may
+ * leave the band where it moved further. Every contour touching the band
+ * is traced completely, with the same edges as compute_faster
+ *
+ * The whole grid is swept instead when there are no previous cells, or
+ * when the band or the followed contour takes more than max_band_fraction
+ * of the cells. A contour that newly appears away from the band is only
+ * found by a full sweep, calling this with no previous cells forces one
+ *
+ * @param iso_value The iso value of the contour
+ * @param previous_cells The active cells of the previous step, see active_cells
+ * @param band The number of cells around the previous cells to check
+ * @param max_band_fraction The share of the cells beyond which the whole grid is swept
+ *
+ * @return The contour and its active cells
+ */
+TrackedContour MarchingSquaresBase::compute_tracked(const double iso_value,
+                                                    const CellList& previous_cells,
+                                                    const size_t band,
+                                                    const double max_band_fraction) const
+{
+    if (!(max_band_fraction > 0 && max_band_fraction <= 1))
+        throw std::invalid_argument("MarchingSquares::compute_tracked: The band fraction must be in (0, 1]");
+
+    const auto max_cells = static_cast<size_t>(max_band_fraction * nx1_ * nx2_);
+
+    const auto sweep_all = [&]()
+    {
+        TrackedContour result;
+        std::tie(result.vertices, result.indices) = compute_faster(iso_value);
+        result.active_cells = active_cells(result.vertices, result.indices);
+        result.full_sweep = true;
+        result.node_evaluations = (nx1_ + 1) * (nx2_ + 1);
+
+        return result;
+    };
+
+    if (previous_cells.empty() || previous_cells.size() > max_cells)
+        return sweep_all();
+
+    // Grow the previous cells by the band, indexed along the sweep
+    std::vector<uint64_t> seeds;
+    for (const auto cell : previous_cells)
+    {
+        const auto ix = static_cast<size_t>(cell % resolution_[0]);
+        const auto iy = static_cast<size_t>(cell / resolution_[0]);
+
+        if (iy >= resolution_[1])
+            throw std::invalid_argument("MarchingSquares::compute_tracked: A previous cell lies outside the grid");
+
+        const auto i = x_major_ ? ix : iy;
+        const auto j = x_major_ ? iy : ix;
+
+        for (auto ii = i > band ? i - band : 0; ii <= std::min(i + band, nx1_ - 1); ++ii)
+            for (auto jj = j > band ? j - band : 0; jj <= std::min(j + band, nx2_ - 1); ++jj)
+                seeds.push_back(static_cast<uint64_t>(ii) * nx2_ + jj);
+    }
+
+    std::sort(seeds.begin(), seeds.end());
+    seeds.erase(std::unique(seeds.begin(), seeds.end()), seeds.end());
+
+    if (seeds.size() > max_cells)
+        return sweep_all();
+
+    AdaptiveState state;
+    state.iso_value = iso_value;
+
+    for (const auto seed : seeds)
+        state.pending_cells.push_back({ static_cast<size_t>(seed / nx2_), static_cast<size_t>(seed % nx2_) });
+
+    TrackedContour result;
+
+    while (!state.pending_cells.empty())
+    {
+        const auto cell = state.pending_cells.back();
+        state.pending_cells.pop_back();
+
+        if (!state.visited_cells.insert(static_cast<uint64_t>(cell[0]) * nx2_ + cell[1]).second)
+            continue;
+
+        // The contour grew too long to be worth following
+        if (state.visited_cells.size() > max_cells)
+            return sweep_all();
+
+        const auto segments = state.indices.size();
+        follow_cell(state, cell[0], cell[1]);
+
+        if (state.indices.size() != segments)
+        {
+            const auto ix = x_major_ ? cell[0] : cell[1];
+            const auto iy = x_major_ ? cell[1] : cell[0];
+
+            result.active_cells.push_back(static_cast<uint64_t>(iy) * resolution_[0] + ix);
+        }
+    }
+
+    std::sort(result.active_cells.begin(), result.active_cells.end());
+
+    result.vertices = std::move(state.vertices);
+    result.indices = std::move(state.indices);
+    result.node_evaluations = state.node_values.size();
+
+    return result;
+}
+
+/**
+ * Finds the cells a contour passes through
+ *
+ * Every segment lies within one cell, which is found from its midpoint
+ *
+ * @param vertices The vertices of the contour, computed on this grid
+ * @param indices The segments of the contour
+ *
+ * @return The cells, each listed once
+ */
+CellList MarchingSquaresBase::active_cells(const VerticesList& vertices, const IndicesList& indices) const
+{
+    const auto cell_of = [](const double value, const double lower, const double step, const size_t cells)
+    {
+        const auto cell = std::floor((value - lower) / step);
+
+        return cell > 0 ? std::min(static_cast<size_t>(cell), cells - 1) : size_t(0);
+    };
+
+    CellList cells;
+    cells.reserve(indices.size());
+
+    for (const auto& edge : indices)
+    {
+        const auto& a = vertices[edge[0]];
+        const auto& b = vertices[edge[1]];
+
+        const auto ix = cell_of((a[0] + b[0]) / 2, x_limits_[0], dx_, resolution_[0]);
+        const auto iy = cell_of((a[1] + b[1]) / 2, y_limits_[0], dy_, resolution_[1]);
+
+        cells.push_back(static_cast<uint64_t>(iy) * resolution_[0] + ix);
+    }
+
+    std::sort(cells.begin(), cells.end());
+    cells.erase(std::unique(cells.begin(), cells.end()), cells.end());
+
+    return cells;
+}
+
+/**
+ * Computes the contours of several iso values in a single sweep
+ *
+ * Every node is sampled only once, no matter how many levels are asked for.
+ * The vertices and indices of level l are stored in the ranges
+ * [offsets[l][0], offsets[l + 1][0]) and [offsets[l][1], offsets[l + 1][1])
+ * of the returned buffers. Indices refer to the whole vertex buffer
+ *
+ * @param iso_values The iso values to compute the contours for
+ *
+ * @return The vertices, the indices and the offset table with iso_values.size() + 1 rows
+ */
+std::tuple<VerticesList, IndicesList, OffsetTable> MarchingSquaresBase::compute_levels(const std::vector<double>& iso_values) const
+{
+    Workspace workspace;
+    compute_levels(iso_values, workspace);
+
+    return std::make_tuple(std::move(workspace.vertices_), std::move(workspace.indices_), std::move(workspace.offsets_));
+}
+
+/**
+ * Computes the contours of several iso values into a workspace
+ *
+ * @param iso_values The iso values to compute the contours for
+ * @param workspace The workspace to use, it holds the result afterwards
+ */
+void MarchingSquaresBase::compute_levels(const std::vector<double>& iso_values, Workspace& workspace) const
+{
+    sweep(iso_values.data(), iso_values.size(), workspace);
+}
+
+/**
+ * Runs the jobs of all the marching squares objects, one at a time per hardware thread
+ *
+ * The sweep of a job still uses the thread pool of its object
+ */
+static ThreadPool& JobExecutor()
+{
+    static ThreadPool executor(ThreadPool::hardware_threads());
+
+    return executor;
+}
+
+/**
+ * Starts computing the contour in the background
+ *
+ * @param iso_value The iso value of the contour
+ *
+ * @return The job, its result is the same as the one of compute_faster
+ */
+ContourJob MarchingSquaresBase::compute_faster_async(const double iso_value) const
+{
+    return ContourJob::submit(JobExecutor(), [this, iso_value](ComputeProgress& progress)
+    {
+        Workspace workspace;
+        sweep(&iso_value, 1, workspace, &progress);
+
+        return std::make_tuple(std::move(workspace.vertices_), std::move(workspace.indices_));
+    });
+}
+
+/**
+ * Starts computing the contours of several iso values in the background
+ *
+ * @param iso_values The iso values to compute the contours for
+ *
+ * @return The job, its result is the same as the one of compute_levels
+ */
+LevelsJob MarchingSquaresBase::compute_levels_async(std::vector<double> iso_values) const
+{
+    auto levels = std::make_shared<const std::vector<double>>(std::move(iso_values));
+
+    return LevelsJob::submit(JobExecutor(), [this, levels](ComputeProgress& progress)
+    {
+        Workspace workspace;
+        sweep(levels->data(), levels->size(), workspace, &progress);
+
+        return std::make_tuple(std::move(workspace.vertices_), std::move(workspace.indices_), std::move(workspace.offsets_));
+    });
+}
+
+/**
+ * Sets the number of threads used by compute_faster
+ *
+ * It is safe to call while computations are running, they finish with the previous setting
+ *
+ * @param thread_count The number of threads, 0 picks the number of hardware threads
+ */
+void MarchingSquaresBase::set_thread_count(const size_t thread_count)
+{
+    thread_pool_.set_thread_count(thread_count);
+}
+
+size_t MarchingSquaresBase::thread_count() const
+{
+    return thread_pool_.thread_count();
+}
+
+/**
+ * Keeps the sampled field for later calls, or drops it
+ *
+ * Enabling samples the whole grid right away, on the thread pool if there
+ * is one. It takes one double per node, the result of a computation does
+ * not change. It is safe to call while computations are running, they
+ * finish with the previous setting
+ *
+ * @param enabled Whether to keep the sampled field
+ */
+void MarchingSquaresBase::set_field_caching(const bool enabled)
+{
+    if (enabled == field_caching())
+        return;
+
+    std::shared_ptr<const FieldCache> field_cache;
+    if (enabled)
+    {
+        const auto thread_pool = thread_pool_.pool();
+        field_cache = build_field_cache(thread_pool.get());
+    }
+
+    std::atomic_store(&field_cache_, field_cache);
+}
+
+bool MarchingSquaresBase::field_caching() const
+{
+    return std::atomic_load(&field_cache_) != nullptr;
+}
+
+template class MarchingSquaresT<Function>;
+
 } // namespace marching_squares
@@ -0,0 +1,442 @@
+// Internal Includes
+#include "MeshWriter.h"
+
+// Standard includes
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+#include <memory>
+#include <stdexcept>
+
+namespace marching_squares {
+
+namespace {
+
+const char MeshMagic[8] = { 'M', 'S', 'M', 'E', 'S', 'H', '2', 'D' };
+constexpr uint32_t MeshVersion = 1;
+constexpr size_t MeshHeaderSize = 32;
+
+// Vertices are gathered and edges copied in blocks of this size
+constexpr size_t BufferSize = size_t(1) << 22;
+
+bool LittleEndian()
+{
+    const uint16_t probe = 1;
+    uint8_t first;
+    std::memcpy(&first, &probe, 1);
+
+    return first == 1;
+}
+
+size_t CoordinateSize(const MeshPrecision precision)
+{
+    return precision == MeshPrecision::Float32 ? sizeof(float) : sizeof(double);
+}
+
+struct FileCloser
+{
+    void operator()(std::FILE* file) const
+    {
+        std::fclose(file);
+    }
+};
+
+using FileHandle = std::unique_ptr<std::FILE, FileCloser>;
+
+/**
+ * @return The length of a file in bytes, the position is moved back to the start
+ */
+uint64_t FileLength(std::FILE* file, const std::string& path)
+{
+#if defined(_WIN32)
+    const auto length = _fseeki64(file, 0, SEEK_END) == 0 ? _ftelli64(file) : -1;
+#else
+    const auto length = std::fseek(file, 0, SEEK_END) == 0 ? std::ftell(file) : -1;
+#endif
+
+    if (length < 0 || std::fseek(file, 0, SEEK_SET) != 0)
+        throw std::runtime_error("ReadMesh: Could not read the size of " + path);
+
+    return static_cast<uint64_t>(length);
+}
+
+} // namespace
+
+/**
+ * Constructor of the mesh writer, creates the file and writes its header
+ *
+ * @param path The file to write
+ * @param format The format of the file
+ * @param precision The type of the vertex coordinates
+ */
+MeshWriter::MeshWriter(const std::string& path, const MeshFormat format, const MeshPrecision precision):
+    path_(path),
+    format_(format),
+    precision_(precision)
+{
+    file_ = std::fopen(path.c_str(), "wb");
+    if (!file_)
+        throw std::runtime_error("MeshWriter::Constructor: Could not create " + path);
+
+    edges_ = std::tmpfile();
+    if (!edges_)
+    {
+        close();
+        throw std::runtime_error("MeshWriter::Constructor: Could not create a temporary file for the edges");
+    }
+
+    buffer_.reserve(BufferSize);
+    edge_buffer_.reserve(BufferSize / sizeof(EdgeVertices));
+
+    write_header();
+}
+
+/**
+ * Closes the files, without finish the file is left incomplete
+ */
+MeshWriter::~MeshWriter()
+{
+    close();
+}
+
+/**
+ * Appends vertices and the edges between them
+ *
+ * @param vertices The vertices to append
+ * @param vertex_count The number of vertices
+ * @param indices The edges, given as indices into these vertices
+ * @param index_count The number of edges
+ */
+void MeshWriter::append(const Point2D* vertices, const size_t vertex_count, const EdgeVertices* indices, const size_t index_count)
+{
+    if (!file_)
+        throw std::logic_error("MeshWriter::append: The writer is already finished");
+
+    const auto base = vertex_count_;
+
+    write_vertices(vertices, vertex_count);
+    write_edges(indices, index_count, base);
+}
+
+void MeshWriter::append(const VerticesList& vertices, const IndicesList& indices)
+{
+    append(vertices.data(), vertices.size(), indices.data(), indices.size());
+}
+
+/**
+ * Appends a chunk of compute_streaming
+ *
+ * @param chunk The chunk, in the order the sink received it
+ * @param indexing The indexing compute_streaming was called with
+ */
+void MeshWriter::append(const ContourChunk& chunk, const ChunkIndexing indexing)
+{
+    if (indexing == ChunkIndexing::Local)
+    {
+        append(chunk.vertices, chunk.indices);
+        return;
+    }
+
+    if (!file_)
+        throw std::logic_error("MeshWriter::append: The writer is already finished");
+    if (chunk.vertex_offset != vertex_count_)
+        throw std::invalid_argument("MeshWriter::append: Globally indexed chunks must be appended in order");
+
+    // The indices already refer to all the vertices written so far
+    write_vertices(chunk.vertices.data(), chunk.vertices.size());
+    write_edges(chunk.indices.data(), chunk.indices.size(), 0);
+}
+
+/**
+ * Writes the edges behind the vertices and fills in the counts
+ */
+void MeshWriter::finish()
+{
+    if (!file_)
+        throw std::logic_error("MeshWriter::finish: The writer is already finished");
+
+    flush_buffer();
+
+    if (!edge_buffer_.empty())
+        std::fwrite(edge_buffer_.data(), sizeof(EdgeVertices), edge_buffer_.size(), edges_);
+    edge_buffer_.clear();
+
+    std::rewind(edges_);
+    buffer_.resize(BufferSize);
+
+    size_t read;
+    while ((read = std::fread(buffer_.data(), 1, BufferSize, edges_)) > 0)
+        std::fwrite(buffer_.data(), 1, read, file_);
+
+    buffer_.clear();
+
+    const auto failed = std::ferror(edges_) != 0;
+
+    // The header has the same size with the final counts
+    std::fseek(file_, 0, SEEK_SET);
+    write_header();
+
+    const auto write_failed = std::ferror(file_) != 0 || std::fflush(file_) != 0;
+    close();
+
+    if (failed || write_failed)
+        throw std::runtime_error("MeshWriter::finish: Could not write " + path_);
+}
+
+size_t MeshWriter::vertex_count() const
+{
+    return vertex_count_;
+}
+
+size_t MeshWriter::edge_count() const
+{
+    return edge_count_;
+}
+
+void MeshWriter::write_header()
+{
+    if (format_ == MeshFormat::Binary)
+    {
+        const auto coordinate_size = static_cast<uint32_t>(CoordinateSize(precision_));
+        const auto vertex_count = static_cast<uint64_t>(vertex_count_);
+        const auto edge_count = static_cast<uint64_t>(edge_count_);
+
+        char header[MeshHeaderSize];
+        std::memcpy(header, MeshMagic, 8);
+        std::memcpy(header + 8, &MeshVersion, 4);
+        std::memcpy(header + 12, &coordinate_size, 4);
+        std::memcpy(header + 16, &vertex_count, 8);
+        std::memcpy(header + 24, &edge_count, 8);
+
+        std::fwrite(header, 1, MeshHeaderSize, file_);
+        return;
+    }
+
+    const auto type = precision_ == MeshPrecision::Float32 ? "float" : "double";
+
+    // Fixed width counts, so the header keeps its size once they are known
+    char header[512];
+    const auto size = std::snprintf(header, sizeof(header),
+        "ply\n"
+        "format %s 1.0\n"
+        "comment marching squares contour\n"
+        "element vertex %020llu\n"
+        "property %s x\n"
+        "property %s y\n"
+        "property %s z\n"
+        "element edge %020llu\n"
+        "property int vertex1\n"
+        "property int vertex2\n"
+        "end_header\n",
+        LittleEndian() ? "binary_little_endian" : "binary_big_endian",
+        static_cast<unsigned long long>(vertex_count_),
+        type, type, type,
+        static_cast<unsigned long long>(edge_count_));
+
+    std::fwrite(header, 1, static_cast<size_t>(size), file_);
+}
+
+/**
+ * Appends vertices to the file, converted to the coordinate type of the format
+ *
+ * @param vertices The vertices
+ * @param vertex_count The number of vertices
+ */
+void MeshWriter::write_vertices(const Point2D* vertices, const size_t vertex_count)
+{
+    // Edges hold 32 bit indices, PLY readers mostly read them as int
+    const auto limit = format_ == MeshFormat::Ply ? size_t(std::numeric_limits<int32_t>::max()) : size_t(std::numeric_limits<uint32_t>::max()) + 1;
+    if (vertex_count > limit - vertex_count_)
+        throw std::length_error("MeshWriter::append: Too many vertices for the edge indices of the format");
+
+    if (format_ == MeshFormat::Binary && precision_ == MeshPrecision::Float64)
+    {
+        // The layout in memory is the layout in the file
+        flush_buffer();
+        std::fwrite(vertices, sizeof(Point2D), vertex_count, file_);
+    }
+    else
+    {
+        const auto with_z = format_ == MeshFormat::Ply;
+        const auto record = CoordinateSize(precision_) * (with_z ? 3 : 2);
+
+        for (size_t k = 0; k < vertex_count; ++k)
+        {
+            if (buffer_.size() + record > BufferSize)
+                flush_buffer();
+
+            const auto position = buffer_.size();
+            buffer_.resize(position + record);
+            auto* out = buffer_.data() + position;
+
+            if (precision_ == MeshPrecision::Float32)
+            {
+                const float coordinates[3] = { static_cast<float>(vertices[k][0]), static_cast<float>(vertices[k][1]), 0.f };
+                std::memcpy(out, coordinates, record);
+            }
+            else
+            {
+                const double coordinates[3] = { vertices[k][0], vertices[k][1], 0. };
+                std::memcpy(out, coordinates, record);
+            }
+        }
+    }
+
+    vertex_count_ += vertex_count;
+}
+
+/**
+ * Appends edges to the temporary edge file
+ *
+ * @param indices The edges
+ * @param index_count The number of edges
+ * @param base The number added to every index
+ */
+void MeshWriter::write_edges(const EdgeVertices* indices, const size_t index_count, const size_t base)
+{
+    const auto capacity = edge_buffer_.capacity();
+
+    if (base == 0)
+    {
+        if (!edge_buffer_.empty())
+            std::fwrite(edge_buffer_.data(), sizeof(EdgeVertices), edge_buffer_.size(), edges_);
+        edge_buffer_.clear();
+
+        std::fwrite(indices, sizeof(EdgeVertices), index_count, edges_);
+    }
+    else
+    {
+        const auto offset = static_cast<uint32_t>(base);
+
+        for (size_t k = 0; k < index_count; ++k)
+        {
+            if (edge_buffer_.size() == capacity)
+            {
+                std::fwrite(edge_buffer_.data(), sizeof(EdgeVertices), edge_buffer_.size(), edges_);
+                edge_buffer_.clear();
+            }
+
+            edge_buffer_.push_back({ indices[k][0] + offset, indices[k][1] + offset });
+        }
+    }
+
+    edge_count_ += index_count;
+}
+
+void MeshWriter::flush_buffer()
+{
+    if (!buffer_.empty())
+        std::fwrite(buffer_.data(), 1, buffer_.size(), file_);
+
+    buffer_.clear();
+}
+
+void MeshWriter::close()
+{
+    if (file_)
+        std::fclose(file_);
+    if (edges_)
+        std::fclose(edges_);
+
+    file_ = nullptr;
+    edges_ = nullptr;
+}
+
+/**
+ * Writes a whole contour to a file
+ *
+ * @param path The file to write
+ * @param vertices The vertices of the contour
+ * @param indices The edges of the contour
+ * @param format The format of the file
+ * @param precision The type of the vertex coordinates
+ */
+void WriteMesh(const std::string& path,
+               const VerticesList& vertices,
+               const IndicesList& indices,
+               const MeshFormat format,
+               const MeshPrecision precision)
+{
+    MeshWriter writer(path, format, precision);
+    writer.append(vertices, indices);
+    writer.finish();
+}
+
+/**
+ * Reads a contour written in the binary format
+ *
+ * @param path The file to read
+ * @return The vertices and the edges
+ */
+std::tuple<VerticesList, IndicesList> ReadMesh(const std::string& path)
+{
+    FileHandle handle(std::fopen(path.c_str(), "rb"));
+    if (!handle)
+        throw std::runtime_error("ReadMesh: Could not open " + path);
+
+    const auto file = handle.get();
+    const auto length = FileLength(file, path);
+
+    char header[MeshHeaderSize];
+    uint32_t version, coordinate_size;
+    uint64_t vertex_count, edge_count;
+
+    const auto header_read = std::fread(header, 1, MeshHeaderSize, file) == MeshHeaderSize;
+    std::memcpy(&version, header + 8, 4);
+    std::memcpy(&coordinate_size, header + 12, 4);
+    std::memcpy(&vertex_count, header + 16, 8);
+    std::memcpy(&edge_count, header + 24, 8);
+
+    if (!header_read || std::memcmp(header, MeshMagic, 8) != 0 || version != MeshVersion ||
+        (coordinate_size != sizeof(float) && coordinate_size != sizeof(double)))
+    {
+        throw std::invalid_argument("ReadMesh: " + path + " is not a binary mesh file");
+    }
+
+    // Check the counts against the file before allocating for them, without overflowing
+    const auto vertex_size = uint64_t(2) * coordinate_size;
+    const auto body = length - MeshHeaderSize;
+
+    if (vertex_count > body / vertex_size || edge_count > (body - vertex_count * vertex_size) / sizeof(EdgeVertices) ||
+        vertex_count > std::numeric_limits<size_t>::max() || edge_count > std::numeric_limits<size_t>::max())
+    {
+        throw std::runtime_error("ReadMesh: " + path + " is truncated");
+    }
+
+    VerticesList vertices(static_cast<size_t>(vertex_count));
+    IndicesList indices(static_cast<size_t>(edge_count));
+
+    auto complete = true;
+
+    if (coordinate_size == sizeof(double))
+        complete = std::fread(vertices.data(), sizeof(Point2D), vertices.size(), file) == vertices.size();
+    else
+    {
+        std::vector<std::array<float, 2>> block(BufferSize / sizeof(std::array<float, 2>));
+
+        for (size_t first = 0; first < vertices.size() && complete; first += block.size())
+        {
+            const auto count = std::min(block.size(), vertices.size() - first);
+            complete = std::fread(block.data(), sizeof(block[0]), count, file) == count;
+
+            for (size_t k = 0; k < count; ++k)
+                vertices[first + k] = { block[k][0], block[k][1] };
+        }
+    }
+
+    complete = complete && std::fread(indices.data(), sizeof(EdgeVertices), indices.size(), file) == indices.size();
+
+    if (!complete)
+        throw std::runtime_error("ReadMesh: " + path + " is truncated");
+
+    for (const auto& edge : indices)
+    {
+        if (edge[0] >= vertex_count || edge[1] >= vertex_count)
+            throw std::invalid_argument("ReadMesh: " + path + " has an edge to a vertex it does not hold");
+    }
+
+    return std::make_tuple(std::move(vertices), std::move(indices));
+}
+
+} // namespace marching_squares
@@ -0,0 +1,78 @@
+// Internal Includes
+#include "NodeClassifier.h"
+
+// Standard includes
+#include <algorithm>
+
+#if defined(__AVX__) || defined(__SSE2__) || defined(_M_X64)
+#include <immintrin.h>
+#endif
+
+namespace marching_squares {
+
+/**
+ * @param count The number of nodes
+ *
+ * @return The number of words needed to hold one bit per node
+ */
+size_t MaskWords(const size_t count)
+{
+    return (count + 63) / 64;
+}
+
+/**
+ * Classifies the nodes against the iso value
+ *
+ * @param values The values of the nodes
+ * @param count The number of nodes
+ * @param iso_value The iso value of the contour
+ * @param above Output, MaskWords(count) words with the nodes above the iso value
+ * @param below Output, MaskWords(count) words with the nodes below the iso value
+ */
+void ClassifyNodes(const double* values, const size_t count, const double iso_value, uint64_t* above, uint64_t* below)
+{
+    const auto words = MaskWords(count);
+
+    for (size_t w = 0; w < words; ++w)
+    {
+        const auto first = w * 64;
+        const auto last = std::min(count, first + 64);
+
+        uint64_t above_bits = 0, below_bits = 0;
+        auto k = first;
+
+#if defined(__AVX__)
+        const auto iso = _mm256_set1_pd(iso_value);
+
+        for (; k + 4 <= last; k += 4)
+        {
+            const auto v = _mm256_loadu_pd(values + k);
+
+            above_bits |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_cmp_pd(v, iso, _CMP_GT_OQ))) << (k - first);
+            below_bits |= static_cast<uint64_t>(_mm256_movemask_pd(_mm256_cmp_pd(v, iso, _CMP_LT_OQ))) << (k - first);
+        }
+#elif defined(__SSE2__) || defined(_M_X64)
+        const auto iso = _mm_set1_pd(iso_value);
+
+        for (; k + 2 <= last; k += 2)
+        {
+            const auto v = _mm_loadu_pd(values + k);
+
+            above_bits |= static_cast<uint64_t>(_mm_movemask_pd(_mm_cmpgt_pd(v, iso))) << (k - first);
+            below_bits |= static_cast<uint64_t>(_mm_movemask_pd(_mm_cmplt_pd(v, iso))) << (k - first);
+        }
+#endif
+
+        // Scalar fallback and the remainder of the vectorized loops
+        for (; k < last; ++k)
+        {
+            above_bits |= static_cast<uint64_t>(values[k] > iso_value) << (k - first);
+            below_bits |= static_cast<uint64_t>(values[k] < iso_value) << (k - first);
+        }
+
+        above[w] = above_bits;
+        below[w] = below_bits;
+    }
+}
+
+} // namespace marching_squares
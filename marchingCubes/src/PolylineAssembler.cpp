@@ -0,0 +1,96 @@
+// Internal Includes
+#include "PolylineAssembler.h"
+
+namespace marching_squares {
+
+/**
+ * Chains the segments into open polylines and closed loops
+ *
+ * Runs in linear time. The segments of every vertex are found through a
+ * compressed adjacency table, and every segment is walked exactly once
+ *
+ * @param segments The pairs of vertex indices
+ * @param vertex_count The number of vertices the segments refer to
+ *
+ * @return The polylines, every segment is used by exactly one of them
+ */
+Polylines AssemblePolylines(const std::vector<std::array<uint32_t, 2>>& segments, const size_t vertex_count)
+{
+    const auto segment_count = segments.size();
+
+    // The segments touching vertex v are adjacency[first[v], first[v + 1])
+    std::vector<size_t> first(vertex_count + 1, 0);
+    for (const auto& segment : segments)
+    {
+        ++first[segment[0] + 1];
+        ++first[segment[1] + 1];
+    }
+    for (size_t v = 0; v < vertex_count; ++v)
+        first[v + 1] += first[v];
+
+    std::vector<size_t> adjacency(first[vertex_count]);
+    std::vector<size_t> fill(first.begin(), first.end() - 1);
+    for (size_t s = 0; s < segment_count; ++s)
+    {
+        adjacency[fill[segments[s][0]]++] = s;
+        adjacency[fill[segments[s][1]]++] = s;
+    }
+
+    std::vector<uint8_t> used(segment_count, 0);
+
+    Polylines polylines;
+    polylines.indices.reserve(segment_count + segment_count / 4 + 1);
+    polylines.offsets.push_back(0);
+
+    const auto degree = [&](const uint32_t v)
+    {
+        return first[v + 1] - first[v];
+    };
+
+    // Follows unused segments from a vertex until a dead end or a branching vertex
+    const auto walk = [&](const uint32_t start, size_t segment)
+    {
+        auto vertex = start;
+        polylines.indices.push_back(vertex);
+
+        while (true)
+        {
+            used[segment] = 1;
+            vertex = segments[segment][0] == vertex ? segments[segment][1] : segments[segment][0];
+            polylines.indices.push_back(vertex);
+
+            if (vertex == start || degree(vertex) != 2)
+                break;
+
+            // The other segment of the vertex
+            const auto* adjacent = &adjacency[first[vertex]];
+            segment = adjacent[0] == segment ? adjacent[1] : adjacent[0];
+
+            if (used[segment])
+                break;
+        }
+
+        polylines.offsets.push_back(polylines.indices.size());
+        polylines.closed.push_back(vertex == start);
+    };
+
+    // Open polylines start at their ends, or at vertices where several contours meet
+    for (uint32_t v = 0; v < vertex_count; ++v)
+    {
+        if (degree(v) == 2)
+            continue;
+
+        for (auto k = first[v]; k < first[v + 1]; ++k)
+            if (!used[adjacency[k]])
+                walk(v, adjacency[k]);
+    }
+
+    // Only closed loops are left
+    for (size_t s = 0; s < segment_count; ++s)
+        if (!used[s])
+            walk(segments[s][0], s);
+
+    return polylines;
+}
+
+} // namespace marching_squares
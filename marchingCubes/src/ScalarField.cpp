@@ -0,0 +1,274 @@
+// Internal Includes
+#include "ScalarField.h"
+
+// Standard includes
+#include <cmath>
+#include <stdexcept>
+#include <vector>
+
+namespace marching_squares {
+
+ScalarField::ScalarField(const Resolution& resolution):
+    resolution_(resolution)
+{
+}
+
+/**
+ * @return The number of cells in the x and y direction
+ */
+const Resolution& ScalarField::resolution() const
+{
+    return resolution_;
+}
+
+/**
+ * Samples consecutive nodes along one axis
+ *
+ * @param ix The x index of the first node
+ * @param iy The y index of the first node
+ * @param along_x Step along x if true, along y otherwise
+ * @param count The number of nodes to sample
+ * @param out Output, receives the count values
+ */
+void ScalarField::sample_line(const size_t ix, const size_t iy, const bool along_x, const size_t count, double* out) const
+{
+    for (size_t k = 0; k < count; ++k)
+        out[k] = along_x ? value(ix + k, iy) : value(ix, iy + k);
+}
+
+/**
+ * Samples consecutive nodes along one axis with scratch buffers of the caller
+ *
+ * @param ix The x index of the first node
+ * @param iy The y index of the first node
+ * @param along_x Step along x if true, along y otherwise
+ * @param count The number of nodes to sample
+ * @param out Output, receives the count values
+ * @param scratch Buffers the field may resize and use, they keep their capacity for the next line
+ */
+void ScalarField::sample_line(const size_t ix, const size_t iy, const bool along_x, const size_t count, double* out, LineScratch& /*scratch*/) const
+{
+    sample_line(ix, iy, along_x, count, out);
+}
+
+/**
+ * @return The major axis the field is read fastest along, Any by default
+ */
+MajorAxis ScalarField::preferred_major_axis() const
+{
+    return MajorAxis::Any;
+}
+
+/**
+ * Bounds the values of the field over a block of nodes without sampling it
+ *
+ * @param ix0 The x index of the first node
+ * @param iy0 The y index of the first node
+ * @param ix1 The x index of the last node
+ * @param iy1 The y index of the last node
+ * @param range Output, receives an interval holding the values at all the nodes of the block
+ *
+ * @return false if the field has no such bound, the default
+ */
+bool ScalarField::value_range(const size_t /*ix0*/, const size_t /*iy0*/, const size_t /*ix1*/, const size_t /*iy1*/, Limits& /*range*/) const
+{
+    return false;
+}
+
+/**
+ * Constructor of the bounded field
+ *
+ * @param field The field to bound
+ * @param range Bounds the values over a rectangle of coordinates
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ */
+BoundedField::BoundedField(std::shared_ptr<const ScalarField> field,
+                           RangeFunction range,
+                           const Limits& x_limits,
+                           const Limits& y_limits):
+    ScalarField(field->resolution()),
+    field_(std::move(field)),
+    range_(std::move(range)),
+    x_lower_(x_limits[0]),
+    y_lower_(y_limits[0]),
+    dx_((x_limits[1] - x_limits[0]) / resolution()[0]),
+    dy_((y_limits[1] - y_limits[0]) / resolution()[1])
+{
+    if (!range_)
+        throw std::invalid_argument("BoundedField::Constructor: The range function is empty");
+}
+
+double BoundedField::value(const size_t ix, const size_t iy) const
+{
+    return field_->value(ix, iy);
+}
+
+void BoundedField::sample_line(const size_t ix, const size_t iy, const bool along_x, const size_t count, double* out) const
+{
+    field_->sample_line(ix, iy, along_x, count, out);
+}
+
+void BoundedField::sample_line(const size_t ix, const size_t iy, const bool along_x, const size_t count, double* out, LineScratch& scratch) const
+{
+    field_->sample_line(ix, iy, along_x, count, out, scratch);
+}
+
+MajorAxis BoundedField::preferred_major_axis() const
+{
+    return field_->preferred_major_axis();
+}
+
+bool BoundedField::value_range(const size_t ix0, const size_t iy0, const size_t ix1, const size_t iy1, Limits& range) const
+{
+    // Rounding the node coordinates keeps their order, so the corners enclose the block
+    range = range_({ x_lower_ + ix0 * dx_, x_lower_ + ix1 * dx_ }, { y_lower_ + iy0 * dy_, y_lower_ + iy1 * dy_ });
+
+    return true;
+}
+
+/**
+ * Bounds a function through its Lipschitz constant
+ *
+ * A function changing by at most lipschitz times the distance between two
+ * points stays within that much of its value at the center of a rectangle,
+ * times half its diagonal
+ *
+ * @param function The function to bound
+ * @param lipschitz The Lipschitz constant of the function, for the euclidean distance
+ *
+ * @return The range function
+ */
+RangeFunction LipschitzRange(Function function, const double lipschitz)
+{
+    if (!(lipschitz >= 0))
+        throw std::invalid_argument("LipschitzRange: The Lipschitz constant must not be negative");
+
+    return [function, lipschitz](const Limits& x_range, const Limits& y_range)
+    {
+        const auto center = function((x_range[0] + x_range[1]) / 2, (y_range[0] + y_range[1]) / 2);
+        const auto spread = lipschitz * std::hypot(x_range[1] - x_range[0], y_range[1] - y_range[0]) / 2;
+
+        // A little slack for the rounding of the center value and the spread
+        const auto slack = 1e-12 * (std::fabs(center) + spread);
+
+        return Limits{ center - spread - slack, center + spread + slack };
+    };
+}
+
+/**
+ * Constructor of the batched function field
+ *
+ * @param function The function to evaluate at arrays of nodes
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ * @param resolution The number of cells in the x and y direction
+ */
+BatchFunctionField::BatchFunctionField(BatchFunction function,
+                                       const Limits& x_limits,
+                                       const Limits& y_limits,
+                                       const Resolution& resolution):
+    ScalarField(resolution),
+    function_(std::move(function)),
+    x_lower_(x_limits[0]),
+    y_lower_(y_limits[0]),
+    dx_((x_limits[1] - x_limits[0]) / resolution[0]),
+    dy_((y_limits[1] - y_limits[0]) / resolution[1])
+{
+}
+
+double BatchFunctionField::value(const size_t ix, const size_t iy) const
+{
+    const auto x = x_lower_ + ix * dx_;
+    const auto y = y_lower_ + iy * dy_;
+    double result;
+
+    function_(&x, &y, &result, 1);
+
+    return result;
+}
+
+void BatchFunctionField::sample_line(const size_t ix, const size_t iy, const bool along_x, const size_t count, double* out) const
+{
+    // Local buffers, the field may be sampled from several threads at once
+    LineScratch scratch;
+
+    sample_line(ix, iy, along_x, count, out, scratch);
+}
+
+void BatchFunctionField::sample_line(const size_t ix, const size_t iy, const bool along_x, const size_t count, double* out, LineScratch& scratch) const
+{
+    auto& xs = scratch.xs;
+    auto& ys = scratch.ys;
+
+    if (xs.size() < count)
+        xs.resize(count);
+    if (ys.size() < count)
+        ys.resize(count);
+
+    for (size_t k = 0; k < count; ++k)
+    {
+        xs[k] = x_lower_ + (along_x ? ix + k : ix) * dx_;
+        ys[k] = y_lower_ + (along_x ? iy : iy + k) * dy_;
+    }
+
+    function_(xs.data(), ys.data(), out, count);
+}
+
+/**
+ * Constructor of the strided field
+ *
+ * @param values Pointer to the value of node (0, 0)
+ * @param rows The number of nodes in the y direction
+ * @param columns The number of nodes in the x direction
+ * @param row_stride The distance between two rows, in elements
+ * @param column_stride The distance between two columns, in elements
+ * @param owner Optional handle that keeps the memory alive
+ */
+template <typename T>
+StridedField<T>::StridedField(const T* values,
+                              const size_t rows,
+                              const size_t columns,
+                              const std::ptrdiff_t row_stride,
+                              const std::ptrdiff_t column_stride,
+                              std::shared_ptr<const void> owner):
+    ScalarField(shape_to_resolution(rows, columns)),
+    values_(values),
+    row_stride_(row_stride),
+    column_stride_(column_stride),
+    owner_(std::move(owner))
+{
+}
+
+template <typename T>
+Resolution StridedField<T>::shape_to_resolution(const size_t rows, const size_t columns)
+{
+    // Unlike the resolution of a function, there is nothing sensible to fall back to
+    if (rows < 2 || columns < 2)
+        throw std::invalid_argument("StridedField::Constructor: The array needs at least 2 rows and 2 columns");
+
+    return { columns - 1, rows - 1 };
+}
+
+template <typename T>
+double StridedField<T>::value(const size_t ix, const size_t iy) const
+{
+    return static_cast<double>(values_[static_cast<std::ptrdiff_t>(iy) * row_stride_ +
+                                       static_cast<std::ptrdiff_t>(ix) * column_stride_]);
+}
+
+template <typename T>
+void StridedField<T>::sample_line(const size_t ix, const size_t iy, const bool along_x, const size_t count, double* out) const
+{
+    const auto stride = along_x ? column_stride_ : row_stride_;
+    const auto first = static_cast<std::ptrdiff_t>(iy) * row_stride_ + static_cast<std::ptrdiff_t>(ix) * column_stride_;
+
+    for (size_t k = 0; k < count; ++k)
+        out[k] = static_cast<double>(values_[first + static_cast<std::ptrdiff_t>(k) * stride]);
+}
+
+template class FunctionFieldT<Function>;
+template class StridedField<double>;
+template class StridedField<float>;
+
+} // namespace marching_squares
@@ -0,0 +1,142 @@
+// Internal Includes
+#include "ScalarVolume.h"
+
+// Standard includes
+#include <stdexcept>
+
+namespace marching_squares {
+
+ScalarVolume::ScalarVolume(const Resolution3D& resolution):
+    resolution_(resolution)
+{
+}
+
+/**
+ * @return The number of cells in the x, y and z direction
+ */
+const Resolution3D& ScalarVolume::resolution() const
+{
+    return resolution_;
+}
+
+/**
+ * Samples all the nodes of a z slice
+ *
+ * @param iz The z index of the slice
+ * @param out Output, receives (resolution[1] + 1) rows of resolution[0] + 1 values
+ */
+void ScalarVolume::sample_slice(const size_t iz, double* out) const
+{
+    for (size_t iy = 0; iy <= resolution_[1]; ++iy)
+        for (size_t ix = 0; ix <= resolution_[0]; ++ix)
+            *out++ = value(ix, iy, iz);
+}
+
+/**
+ * Constructor of the function volume
+ *
+ * @param function The function to evaluate at the nodes
+ * @param x_limits The lower and upper bounds in the x direction
+ * @param y_limits The lower and upper bounds in the y direction
+ * @param z_limits The lower and upper bounds in the z direction
+ * @param resolution The number of cells in the x, y and z direction
+ */
+FunctionVolume::FunctionVolume(Function3D function,
+                               const Limits& x_limits,
+                               const Limits& y_limits,
+                               const Limits& z_limits,
+                               const Resolution3D& resolution):
+    ScalarVolume(resolution),
+    function_(std::move(function)),
+    lower_({ x_limits[0], y_limits[0], z_limits[0] }),
+    step_({ (x_limits[1] - x_limits[0]) / resolution[0],
+            (y_limits[1] - y_limits[0]) / resolution[1],
+            (z_limits[1] - z_limits[0]) / resolution[2] })
+{
+}
+
+double FunctionVolume::value(const size_t ix, const size_t iy, const size_t iz) const
+{
+    return function_(lower_[0] + ix * step_[0], lower_[1] + iy * step_[1], lower_[2] + iz * step_[2]);
+}
+
+void FunctionVolume::sample_slice(const size_t iz, double* out) const
+{
+    const auto& resolution = this->resolution();
+    const auto z = lower_[2] + iz * step_[2];
+
+    for (size_t iy = 0; iy <= resolution[1]; ++iy)
+    {
+        const auto y = lower_[1] + iy * step_[1];
+
+        for (size_t ix = 0; ix <= resolution[0]; ++ix)
+            *out++ = function_(lower_[0] + ix * step_[0], y, z);
+    }
+}
+
+/**
+ * Constructor of the strided volume
+ *
+ * @param values Pointer to the value of node (0, 0, 0)
+ * @param slices The number of nodes in the z direction
+ * @param rows The number of nodes in the y direction
+ * @param columns The number of nodes in the x direction
+ * @param slice_stride The distance between two slices, in elements
+ * @param row_stride The distance between two rows, in elements
+ * @param column_stride The distance between two columns, in elements
+ * @param owner Optional handle that keeps the memory alive
+ */
+template <typename T>
+StridedVolume<T>::StridedVolume(const T* values,
+                                const size_t slices,
+                                const size_t rows,
+                                const size_t columns,
+                                const std::ptrdiff_t slice_stride,
+                                const std::ptrdiff_t row_stride,
+                                const std::ptrdiff_t column_stride,
+                                std::shared_ptr<const void> owner):
+    ScalarVolume(shape_to_resolution(slices, rows, columns)),
+    values_(values),
+    slice_stride_(slice_stride),
+    row_stride_(row_stride),
+    column_stride_(column_stride),
+    owner_(std::move(owner))
+{
+}
+
+template <typename T>
+Resolution3D StridedVolume<T>::shape_to_resolution(const size_t slices, const size_t rows, const size_t columns)
+{
+    if (slices < 2 || rows < 2 || columns < 2)
+        throw std::invalid_argument("StridedVolume::Constructor: The array needs at least 2 nodes along every axis");
+
+    return { columns - 1, rows - 1, slices - 1 };
+}
+
+template <typename T>
+double StridedVolume<T>::value(const size_t ix, const size_t iy, const size_t iz) const
+{
+    return static_cast<double>(values_[static_cast<std::ptrdiff_t>(iz) * slice_stride_ +
+                                       static_cast<std::ptrdiff_t>(iy) * row_stride_ +
+                                       static_cast<std::ptrdiff_t>(ix) * column_stride_]);
+}
+
+template <typename T>
+void StridedVolume<T>::sample_slice(const size_t iz, double* out) const
+{
+    const auto& resolution = this->resolution();
+    const auto* slice = values_ + static_cast<std::ptrdiff_t>(iz) * slice_stride_;
+
+    for (size_t iy = 0; iy <= resolution[1]; ++iy)
+    {
+        const auto* row = slice + static_cast<std::ptrdiff_t>(iy) * row_stride_;
+
+        for (size_t ix = 0; ix <= resolution[0]; ++ix)
+            *out++ = static_cast<double>(row[static_cast<std::ptrdiff_t>(ix) * column_stride_]);
+    }
+}
+
+template class StridedVolume<double>;
+template class StridedVolume<float>;
+
+} // namespace marching_squares
@@ -0,0 +1,272 @@
+// Internal Includes
+#include "ThreadPool.h"
+
+// Standard includes
+#include <algorithm>
+#include <exception>
+
+namespace marching_squares {
+
+/**
+ * Constructor of the thread pool
+ *
+ * @param worker_count The number of worker threads to spawn
+ */
+ThreadPool::ThreadPool(const size_t worker_count)
+{
+    // Always have at least one queue so submit has a place to put the tasks
+    const auto queue_count = worker_count > 0 ? worker_count : 1;
+
+    for (size_t i = 0; i < queue_count; ++i)
+        queues_.emplace_back(new WorkQueue);
+
+    for (size_t i = 0; i < worker_count; ++i)
+        workers_.emplace_back(&ThreadPool::worker_loop, this, i);
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(wake_mutex_);
+        stop_ = true;
+    }
+    wake_.notify_all();
+
+    for (auto& worker : workers_)
+        worker.join();
+}
+
+size_t ThreadPool::size() const
+{
+    return workers_.size();
+}
+
+size_t ThreadPool::hardware_threads()
+{
+    const auto threads = std::thread::hardware_concurrency();
+
+    return threads > 0 ? threads : 1;
+}
+
+void ThreadPool::submit(Task task)
+{
+    auto& queue = *queues_[next_queue_++ % queues_.size()];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        auto& tasks = queue.tasks;
+
+        // Full, unroll the ring into a larger one
+        if (queue.size == tasks.size())
+        {
+            std::vector<Task> grown(std::max<size_t>(2 * tasks.size(), 16));
+
+            for (size_t k = 0; k < queue.size; ++k)
+                grown[k] = std::move(tasks[(queue.head + k) % tasks.size()]);
+
+            tasks.swap(grown);
+            queue.head = 0;
+        }
+
+        // Count the task before it becomes visible, so try_pop never takes the counter below zero.
+        // The counter is touched under the wake mutex so a worker can not miss the notification
+        {
+            std::lock_guard<std::mutex> wake_lock(wake_mutex_);
+            ++pending_;
+        }
+
+        tasks[(queue.head + queue.size) % tasks.size()] = std::move(task);
+        ++queue.size;
+    }
+
+    wake_.notify_one();
+}
+
+/**
+ * Pops a task, preferring the given queue and stealing from the others otherwise
+ *
+ * @param queue_index The queue owned by the calling thread
+ * @param task Output, the task to run
+ *
+ * @return true if a task was found
+ */
+bool ThreadPool::try_pop(const size_t queue_index, Task& task)
+{
+    const auto count = queues_.size();
+
+    for (size_t k = 0; k < count; ++k)
+    {
+        auto& queue = *queues_[(queue_index + k) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+
+        if (queue.size == 0)
+            continue;
+
+        // Own work is taken from the front, stolen work from the back
+        auto& slot = k == 0 ? queue.tasks[queue.head] : queue.tasks[(queue.head + queue.size - 1) % queue.tasks.size()];
+
+        task = std::move(slot);
+        slot = nullptr;
+
+        if (k == 0)
+            queue.head = (queue.head + 1) % queue.tasks.size();
+        --queue.size;
+        --pending_;
+
+        return true;
+    }
+
+    return false;
+}
+
+void ThreadPool::worker_loop(const size_t index)
+{
+    Task task;
+
+    while (true)
+    {
+        if (try_pop(index, task))
+        {
+            task();
+            task = nullptr;
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(wake_mutex_);
+        wake_.wait(lock, [this] { return stop_ || pending_ > 0; });
+
+        if (stop_ && pending_ == 0)
+            return;
+    }
+}
+
+/**
+ * Runs body(context, i) for all i in [0, count) and waits for all of them to finish
+ *
+ * @param count The number of iterations
+ * @param body The function to call for each iteration
+ * @param context Passed on to body
+ */
+void ThreadPool::run_loop(const size_t count, void (*body)(const void* context, size_t i), const void* context)
+{
+    struct Loop
+    {
+        void (*body)(const void*, size_t);
+        const void* context;
+        size_t count;
+
+        std::atomic<size_t> next;
+
+        // The submitted helpers that did not finish yet
+        size_t helpers;
+
+        std::mutex mutex;
+        std::condition_variable done;
+        std::exception_ptr error;
+
+        void run()
+        {
+            for (auto i = next++; i < count; i = next++)
+            {
+                try
+                {
+                    body(context, i);
+                }
+                catch (...)
+                {
+                    std::lock_guard<std::mutex> lock(mutex);
+                    if (!error)
+                        error = std::current_exception();
+                }
+            }
+        }
+    } loop;
+
+    loop.body = body;
+    loop.context = context;
+    loop.count = count;
+    loop.next = 0;
+
+    // The calling thread takes one share of the work itself
+    const auto helpers = std::min(count > 0 ? count - 1 : 0, workers_.size());
+    loop.helpers = helpers;
+
+    for (size_t k = 0; k < helpers; ++k)
+    {
+        submit([&loop]
+        {
+            loop.run();
+
+            // Count down under the lock, the loop lives on the caller's stack and
+            // must not be touched anymore once the caller saw the last helper finish
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            if (--loop.helpers == 0)
+                loop.done.notify_all();
+        });
+    }
+
+    loop.run();
+
+    // Helpers still queued only have to see that nothing is left, run them instead of idling.
+    // Once no queued task is left, all of ours are running somewhere
+    Task task;
+    while (true)
+    {
+        {
+            std::lock_guard<std::mutex> lock(loop.mutex);
+            if (loop.helpers == 0)
+                break;
+        }
+
+        if (!try_pop(0, task))
+            break;
+
+        task();
+        task = nullptr;
+    }
+
+    std::unique_lock<std::mutex> lock(loop.mutex);
+    loop.done.wait(lock, [&loop] { return loop.helpers == 0; });
+
+    if (loop.error)
+        std::rethrow_exception(loop.error);
+}
+
+/**
+ * @return The current pool, null when the work runs on the calling thread only
+ */
+std::shared_ptr<ThreadPool> ThreadPoolHandle::pool() const
+{
+    return std::atomic_load(&pool_);
+}
+
+/**
+ * Replaces the pool by one for the given number of threads
+ *
+ * @param thread_count The number of threads, 0 picks the number of hardware threads
+ */
+void ThreadPoolHandle::set_thread_count(const size_t thread_count)
+{
+    const auto threads = thread_count > 0 ? thread_count : ThreadPool::hardware_threads();
+
+    if (threads == this->thread_count())
+        return;
+
+    // The calling thread takes part in the work, so one worker less is needed
+    std::shared_ptr<ThreadPool> pool;
+    if (threads > 1)
+        pool = std::make_shared<ThreadPool>(threads - 1);
+
+    std::atomic_store(&pool_, pool);
+}
+
+/**
+ * @return The number of threads, including the calling one
+ */
+size_t ThreadPoolHandle::thread_count() const
+{
+    const auto pool = std::atomic_load(&pool_);
+
+    return pool ? pool->size() + 1 : 1;
+}
+
+} // namespace marching_squares
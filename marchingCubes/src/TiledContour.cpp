@@ -0,0 +1,368 @@
+// Internal Includes
+#include "TiledContour.h"
+#include "Expression.h"
+#include "ThreadPool.h"
+
+// Standard includes
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstring>
+#include <stdexcept>
+#include <utility>
+
+namespace marching_squares {
+
+bool TileKey::operator==(const TileKey& other) const
+{
+    // Compared bit by bit, so the key of a NaN iso value still finds its tile
+    return level == other.level && x == other.x && y == other.y &&
+           std::memcmp(&iso_value, &other.iso_value, sizeof(double)) == 0;
+}
+
+size_t TiledContour::TileKeyHash::operator()(const TileKey& key) const
+{
+    uint64_t iso_bits = 0;
+    std::memcpy(&iso_bits, &key.iso_value, sizeof(double));
+
+    // Boost's hash_combine on the fields, spread over 64 bits
+    uint64_t hash = key.level;
+    for (const auto field : { static_cast<uint64_t>(key.x), static_cast<uint64_t>(key.y), iso_bits })
+        hash ^= field + 0x9e3779b97f4a7c15ull + (hash << 6) + (hash >> 2);
+
+    return static_cast<size_t>(hash);
+}
+
+/**
+ * Evaluates a point by point function for a whole line of nodes
+ */
+static BatchFunction ToBatchFunction(Function function)
+{
+    return [function](const double* xs, const double* ys, double* out, const size_t count)
+    {
+        for (size_t k = 0; k < count; ++k)
+            out[k] = function(xs[k], ys[k]);
+    };
+}
+
+/**
+ * Constructor of the tiled contour
+ *
+ * @param function The function to contour
+ * @param x_limits The lower and upper bounds of the level 0 tile in the x direction
+ * @param y_limits The lower and upper bounds of the level 0 tile in the y direction
+ * @param tile_cells The number of cells along each side of a tile
+ * @param cache_bytes The most memory the cached tiles may take
+ */
+TiledContour::TiledContour(Function function,
+                           const Limits& x_limits,
+                           const Limits& y_limits,
+                           const size_t tile_cells,
+                           const size_t cache_bytes):
+    TiledContour(ToBatchFunction(std::move(function)), x_limits, y_limits, tile_cells, cache_bytes)
+{
+}
+
+/**
+ * Constructor of the tiled contour from a batched function
+ *
+ * The function is called once per column of a tile with the coordinates of all its nodes
+ */
+TiledContour::TiledContour(BatchFunction function,
+                           const Limits& x_limits,
+                           const Limits& y_limits,
+                           const size_t tile_cells,
+                           const size_t cache_bytes):
+    function_(std::move(function)),
+    x_limits_(x_limits),
+    y_limits_(y_limits),
+    tile_cells_(tile_cells),
+    cache_limit_(cache_bytes)
+{
+    if (tile_cells_ == 0)
+        throw std::invalid_argument("TiledContour::Constructor: A tile needs at least one cell");
+    if (!(x_limits_[0] < x_limits_[1]) || !(y_limits_[0] < y_limits_[1]))
+        throw std::invalid_argument("TiledContour::Constructor: The limits must be increasing");
+}
+
+/**
+ * Constructor of the tiled contour from an expression
+ *
+ * @param expression The function of x and y as text, it is compiled to an Expression
+ */
+TiledContour::TiledContour(const std::string& expression,
+                           const Limits& x_limits,
+                           const Limits& y_limits,
+                           const size_t tile_cells,
+                           const size_t cache_bytes):
+    TiledContour(BatchFunction(Expression(expression)), x_limits, y_limits, tile_cells, cache_bytes)
+{
+}
+
+/**
+ * Collects the tiles of a level that overlap a rectangle
+ *
+ * Cached tiles are reused, the missing ones are computed and cached
+ *
+ * @param iso_value The iso value of the contour
+ * @param x_view The lower and upper bounds of the rectangle in the x direction
+ * @param y_view The lower and upper bounds of the rectangle in the y direction
+ * @param level The level of detail, see level_for
+ *
+ * @return The tiles ordered by row, then by column. Every tile holds its own vertices
+ */
+std::vector<std::shared_ptr<const ContourTile>> TiledContour::tiles(const double iso_value,
+                                                                    const Limits& x_view,
+                                                                    const Limits& y_view,
+                                                                    const uint32_t level)
+{
+    if (level > max_level_)
+        throw std::invalid_argument("TiledContour::tiles: The level must be at most " + std::to_string(max_level_));
+    if (!(x_view[0] <= x_view[1]) || !(y_view[0] <= y_view[1]))
+        throw std::invalid_argument("TiledContour::tiles: The view must not be empty");
+
+    const auto tile_width = std::ldexp(x_limits_[1] - x_limits_[0], -static_cast<int>(level));
+    const auto tile_height = std::ldexp(y_limits_[1] - y_limits_[0], -static_cast<int>(level));
+
+    // The range of tiles [first, last] touching the view along an axis
+    const auto tile_range = [](const double lower, const double upper, const double origin, const double size)
+    {
+        const auto first = std::floor((lower - origin) / size);
+        const auto last = std::max(first, std::ceil((upper - origin) / size) - 1);
+
+        return std::array<double, 2>{ first, last };
+    };
+
+    const auto columns = tile_range(x_view[0], x_view[1], x_limits_[0], tile_width);
+    const auto rows = tile_range(y_view[0], y_view[1], y_limits_[0], tile_height);
+
+    // Tile indices are int64, out of its range or not finite they can not be converted
+    const auto representable = [](const std::array<double, 2>& range)
+    {
+        const auto limit = std::ldexp(1.0, 63);
+
+        return range[0] >= -limit && range[1] < limit;
+    };
+
+    if (!representable(columns) || !representable(rows))
+        throw std::invalid_argument("TiledContour::tiles: The view is too far from the grid to index its tiles");
+
+    if ((columns[1] - columns[0] + 1) * (rows[1] - rows[0] + 1) > max_tiles_per_request_)
+        throw std::invalid_argument("TiledContour::tiles: The view covers too many tiles at this level");
+
+    std::vector<std::shared_ptr<const ContourTile>> result;
+
+    // The tiles to compute and where they go in the result
+    std::vector<std::pair<size_t, TileKey>> missing;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+
+        for (auto y = static_cast<int64_t>(rows[0]); y <= static_cast<int64_t>(rows[1]); ++y)
+        {
+            for (auto x = static_cast<int64_t>(columns[0]); x <= static_cast<int64_t>(columns[1]); ++x)
+            {
+                TileKey key;
+                key.level = level;
+                key.x = x;
+                key.y = y;
+                key.iso_value = iso_value;
+
+                const auto found = index_.find(key);
+                if (found != index_.end())
+                {
+                    // Moves the tile to the front, the iterators stay valid
+                    lru_.splice(lru_.begin(), lru_, found->second);
+                    result.push_back(found->second->tile);
+                }
+                else
+                {
+                    missing.emplace_back(result.size(), key);
+                    result.emplace_back();
+                }
+            }
+        }
+    }
+
+    if (missing.empty())
+        return result;
+
+    const auto compute = [&](const size_t k)
+    {
+        result[missing[k].first] = compute_tile(missing[k].second);
+    };
+
+    const auto thread_pool = thread_pool_.pool();
+    if (thread_pool)
+        thread_pool->parallel_for(missing.size(), compute);
+    else
+        for (size_t k = 0; k < missing.size(); ++k)
+            compute(k);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    for (const auto& tile : missing)
+        insert(result[tile.first]);
+
+    tiles_computed_ += missing.size();
+    evict();
+
+    return result;
+}
+
+/**
+ * Picks the level whose cells are about the size of a pixel
+ *
+ * @param x_view The lower and upper bounds of the view in the x direction
+ * @param y_view The lower and upper bounds of the view in the y direction
+ * @param pixels The size of the view in pixels, in the x and y direction
+ *
+ * @return The coarsest level with cells no bigger than a pixel, at most the deepest level
+ */
+uint32_t TiledContour::level_for(const Limits& x_view, const Limits& y_view, const Resolution& pixels) const
+{
+    // A cell of level l is 2^-l of the cell at level 0 in size
+    const auto ratio = [this](const Limits& limits, const Limits& view, const size_t pixels)
+    {
+        return (limits[1] - limits[0]) * std::max<size_t>(pixels, 1) / (tile_cells_ * (view[1] - view[0]));
+    };
+
+    const auto needed = std::max(ratio(x_limits_, x_view, pixels[0]), ratio(y_limits_, y_view, pixels[1]));
+
+    if (!(needed > 1))
+        return 0;
+
+    // A view of zero size asks for infinite detail and gets the deepest level
+    return static_cast<uint32_t>(std::min<double>(std::ceil(std::log2(needed)), max_level_));
+}
+
+/**
+ * Sets the most memory the cached tiles may take, dropping the least recently used ones beyond it
+ *
+ * @param bytes The limit in bytes, 0 disables caching
+ */
+void TiledContour::set_cache_limit(const size_t bytes)
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    cache_limit_ = bytes;
+    evict();
+}
+
+size_t TiledContour::cache_limit() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return cache_limit_;
+}
+
+size_t TiledContour::cached_bytes() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return cached_bytes_;
+}
+
+size_t TiledContour::cached_tiles() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return lru_.size();
+}
+
+/**
+ * @return The number of tiles computed so far, every cache miss computes one
+ */
+size_t TiledContour::tiles_computed() const
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    return tiles_computed_;
+}
+
+void TiledContour::clear_cache()
+{
+    std::lock_guard<std::mutex> lock(mutex_);
+
+    lru_.clear();
+    index_.clear();
+    cached_bytes_ = 0;
+}
+
+/**
+ * Sets the number of tiles computed at the same time
+ *
+ * @param thread_count The number of threads, 0 picks the number of hardware threads
+ */
+void TiledContour::set_thread_count(const size_t thread_count)
+{
+    thread_pool_.set_thread_count(thread_count);
+}
+
+size_t TiledContour::thread_count() const
+{
+    return thread_pool_.thread_count();
+}
+
+/**
+ * Contours a single tile
+ *
+ * @param key The tile to compute
+ */
+std::shared_ptr<const ContourTile> TiledContour::compute_tile(const TileKey& key) const
+{
+    const auto tile_width = std::ldexp(x_limits_[1] - x_limits_[0], -static_cast<int>(key.level));
+    const auto tile_height = std::ldexp(y_limits_[1] - y_limits_[0], -static_cast<int>(key.level));
+
+    auto tile = std::make_shared<ContourTile>();
+    tile->key = key;
+
+    // The shared border of two tiles is computed the same way from both sides
+    tile->x_limits = { x_limits_[0] + key.x * tile_width, x_limits_[0] + (key.x + 1) * tile_width };
+    tile->y_limits = { y_limits_[0] + key.y * tile_height, y_limits_[0] + (key.y + 1) * tile_height };
+
+    const MarchingSquaresBase marching_squares(function_, tile->x_limits, tile->y_limits, { tile_cells_, tile_cells_ });
+    std::tie(tile->vertices, tile->indices) = marching_squares.compute_faster(key.iso_value);
+
+    // The tile is kept for a while, it should not hold on to spare capacity
+    tile->vertices.shrink_to_fit();
+    tile->indices.shrink_to_fit();
+
+    return tile;
+}
+
+/**
+ * Adds a tile at the front of the cache, the lock must be held
+ *
+ * If another call cached the same tile meanwhile, that one is kept
+ */
+void TiledContour::insert(std::shared_ptr<const ContourTile> tile)
+{
+    if (index_.count(tile->key))
+        return;
+
+    const auto bytes = sizeof(ContourTile) +
+                       tile->vertices.capacity() * sizeof(Point2D) +
+                       tile->indices.capacity() * sizeof(EdgeVertices);
+
+    const auto key = tile->key;
+    lru_.push_front({ std::move(tile), bytes });
+    index_.emplace(key, lru_.begin());
+    cached_bytes_ += bytes;
+}
+
+/**
+ * Drops the least recently used tiles until the cache fits its limit, the lock must be held
+ */
+void TiledContour::evict()
+{
+    while (cached_bytes_ > cache_limit_ && !lru_.empty())
+    {
+        const auto& entry = lru_.back();
+
+        cached_bytes_ -= entry.bytes;
+        index_.erase(entry.tile->key);
+        lru_.pop_back();
+    }
+}
+
+} // namespace marching_squares
@@ -0,0 +1,74 @@
+// Internal Includes
+#include "VertexFormat.h"
+
+// Standard includes
+#include <cmath>
+
+namespace marching_squares {
+
+/**
+ * @param vertices The vertices in double precision
+ *
+ * @return The vertices rounded to single precision
+ */
+VerticesListF ToFloatVertices(const std::vector<std::array<double, 2>>& vertices)
+{
+    VerticesListF result(vertices.size());
+
+    for (size_t k = 0; k < vertices.size(); ++k)
+        result[k] = { static_cast<float>(vertices[k][0]), static_cast<float>(vertices[k][1]) };
+
+    return result;
+}
+
+/**
+ * Quantizes the vertices to 16 bits per coordinate
+ *
+ * Coordinates outside the limits are clamped to them
+ *
+ * @param vertices The vertices in double precision
+ * @param x_limits The x coordinates mapped to 0 and 65535
+ * @param y_limits The y coordinates mapped to 0 and 65535
+ *
+ * @return The quantized vertices
+ */
+QuantizedVerticesList QuantizeVertices(const std::vector<std::array<double, 2>>& vertices,
+                                       const std::array<double, 2>& x_limits,
+                                       const std::array<double, 2>& y_limits)
+{
+    const auto x_scale = QuantizationSteps / (x_limits[1] - x_limits[0]);
+    const auto y_scale = QuantizationSteps / (y_limits[1] - y_limits[0]);
+
+    QuantizedVerticesList result(vertices.size());
+
+    for (size_t k = 0; k < vertices.size(); ++k)
+        result[k] = { Quantize(vertices[k][0], x_limits[0], x_scale), Quantize(vertices[k][1], y_limits[0], y_scale) };
+
+    return result;
+}
+
+/**
+ * Maps quantized vertices back to coordinates
+ *
+ * @param vertices The quantized vertices
+ * @param x_limits The limits used for quantizing
+ * @param y_limits The limits used for quantizing
+ *
+ * @return The vertices, within half a step of the original ones
+ */
+std::vector<std::array<double, 2>> DequantizeVertices(const QuantizedVerticesList& vertices,
+                                                      const std::array<double, 2>& x_limits,
+                                                      const std::array<double, 2>& y_limits)
+{
+    const auto x_step = (x_limits[1] - x_limits[0]) / QuantizationSteps;
+    const auto y_step = (y_limits[1] - y_limits[0]) / QuantizationSteps;
+
+    std::vector<std::array<double, 2>> result(vertices.size());
+
+    for (size_t k = 0; k < vertices.size(); ++k)
+        result[k] = { x_limits[0] + vertices[k][0] * x_step, y_limits[0] + vertices[k][1] * y_step };
+
+    return result;
+}
+
+} // namespace marching_squares
@@ -1,5 +1,9 @@
 // Internal Includes
+#include "MappedRasterField.h"
+#include "MarchingCubes.h"
 #include "MarchingSquares.h"
+#include "MeshWriter.h"
+#include "TiledContour.h"
 
 // Pybind includes
 #include <pybind11/pybind11.h>
@@ -8,7 +12,10 @@
 #include <pybind11/functional.h>
 
 // Standard includes
+#include <algorithm>
 #include <memory>
+#include <stdexcept>
+#include <string>
 #include <tuple>
 
 
@@ -16,32 +23,822 @@ namespace py = pybind11;
 
 using namespace marching_squares;
 
+/**
+ * Moves a python object to the heap, shared by C++ owners
+ *
+ * Releasing the reference needs the GIL, the last owner may be a C++ thread,
+ * so the deleter acquires it
+ */
+template <typename T>
+std::shared_ptr<const T> HoldWithGil(T object)
+{
+	return std::shared_ptr<const T>(new T(std::move(object)), [](const T* held)
+	{
+		py::gil_scoped_acquire gil;
+		delete held;
+	});
+}
+
+/**
+ * Moves a vector to the heap and hands it over to numpy without copying
+ *
+ * A py::capsule owns the vector and keeps it alive as long as the array lives
+ */
+template <typename T>
+py::array ToArray(std::vector<T>&& values)
+{
+	auto data = new std::vector<T>{ std::move(values) };
+	const auto capsule = py::capsule(data, [](void* data) { delete reinterpret_cast<std::vector<T>*>(data); });
+
+	return py::array(data->size(), data->data(), capsule);
+}
+
+/**
+ * Wraps a 2D numpy array as the field of a marching squares object without copying it
+ *
+ * The array has one row per y node and one column per x node, like the
+ * output of numpy.meshgrid. A reference to the array is held as long as
+ * the object lives
+ */
+template <typename T>
+std::shared_ptr<MarchingSquares> FromArray(const py::array_t<T, 0>& values, const Limits& x_limits, const Limits& y_limits)
+{
+	if (values.ndim() != 2)
+		throw std::invalid_argument("MarchingSquares: The values must be a 2D array");
+
+	const auto item_size = static_cast<py::ssize_t>(sizeof(T));
+	if (values.strides(0) % item_size != 0 || values.strides(1) % item_size != 0)
+		throw std::invalid_argument("MarchingSquares: The strides of the array must be a multiple of its item size");
+
+	const std::shared_ptr<const void> owner = HoldWithGil(values);
+
+	const auto field = std::make_shared<StridedField<T>>(values.data(),
+		static_cast<size_t>(values.shape(0)),
+		static_cast<size_t>(values.shape(1)),
+		values.strides(0) / item_size,
+		values.strides(1) / item_size,
+		owner);
+
+	return std::make_shared<MarchingSquares>(field, x_limits, y_limits);
+}
+
+/**
+ * Wraps a 3D numpy array as the volume of a marching cubes object without copying it
+ *
+ * The array is indexed as values[z, y, x]. A reference to the array is
+ * held as long as the object lives
+ */
+template <typename T>
+std::shared_ptr<MarchingCubes> VolumeFromArray(const py::array_t<T, 0>& values, const Limits& x_limits, const Limits& y_limits, const Limits& z_limits)
+{
+	if (values.ndim() != 3)
+		throw std::invalid_argument("MarchingCubes: The values must be a 3D array");
+
+	const auto item_size = static_cast<py::ssize_t>(sizeof(T));
+	if (values.strides(0) % item_size != 0 || values.strides(1) % item_size != 0 || values.strides(2) % item_size != 0)
+		throw std::invalid_argument("MarchingCubes: The strides of the array must be a multiple of its item size");
+
+	const std::shared_ptr<const void> owner = HoldWithGil(values);
+
+	const auto volume = std::make_shared<StridedVolume<T>>(values.data(),
+		static_cast<size_t>(values.shape(0)),
+		static_cast<size_t>(values.shape(1)),
+		static_cast<size_t>(values.shape(2)),
+		values.strides(0) / item_size,
+		values.strides(1) / item_size,
+		values.strides(2) / item_size,
+		owner);
+
+	return std::make_shared<MarchingCubes>(volume, x_limits, y_limits, z_limits);
+}
+
+/**
+ * Maps a raster file with a header as the field of a marching squares object
+ *
+ * The file is read row by row as the sweep goes, so it may be larger than the memory
+ */
+std::shared_ptr<MarchingSquares> FromRasterFile(const std::string& path, const Limits& x_limits, const Limits& y_limits)
+{
+	return std::make_shared<MarchingSquares>(std::make_shared<MappedRasterField>(path), x_limits, y_limits);
+}
+
+/**
+ * Maps a raw raster file of the given type and dimensions, the values start at offset bytes
+ */
+std::shared_ptr<MarchingSquares> FromRawRasterFile(const std::string& path,
+                                                   const std::string& dtype,
+                                                   const size_t rows,
+                                                   const size_t columns,
+                                                   const Limits& x_limits,
+                                                   const Limits& y_limits,
+                                                   const size_t offset)
+{
+	if (dtype != "float32" && dtype != "float64")
+		throw std::invalid_argument("MarchingSquares: The dtype must be float32 or float64");
+
+	const auto type = dtype == "float32" ? RasterType::Float32 : RasterType::Float64;
+
+	return std::make_shared<MarchingSquares>(std::make_shared<MappedRasterField>(path, type, rows, columns, offset), x_limits, y_limits);
+}
+
+/**
+ * Wraps a vectorized python function as a batch function
+ *
+ * The function is called as f(xs, ys) with numpy arrays holding the
+ * coordinates of a whole column and must return one value per point.
+ * This way numpy (or numba) runs the math and python is only entered once
+ * per column instead of once per node
+ */
+BatchFunction VectorizedFunction(const py::function& function)
+{
+	const auto handle = HoldWithGil(function);
+
+	BatchFunction batch = [handle](const double* xs, const double* ys, double* out, const size_t count)
+	{
+		py::gil_scoped_acquire gil;
+
+		const auto result = (*handle)(py::array_t<double>(count, xs), py::array_t<double>(count, ys));
+		const auto values = py::array_t<double, py::array::c_style | py::array::forcecast>::ensure(result);
+
+		if (!values || static_cast<size_t>(values.size()) != count)
+			throw std::runtime_error("MarchingSquares: A vectorized function must return one value per point");
+
+		std::copy(values.data(), values.data() + count, out);
+	};
+
+	return batch;
+}
+
+/**
+ * Creates a marching squares object from a python function, see VectorizedFunction
+ *
+ * With value_range(x_range, y_range) returning (lower, upper) bounds of the
+ * function over a rectangle, or a Lipschitz constant, the blocks of the
+ * grid the contour can not pass through are not sampled
+ */
+std::shared_ptr<MarchingSquares> FromFunction(const py::function& function,
+                                              const Limits& x_limits,
+                                              const Limits& y_limits,
+                                              const Resolution& resolution,
+                                              const bool vectorized,
+                                              const py::object& value_range,
+                                              const py::object& lipschitz)
+{
+	if (!value_range.is_none() && !lipschitz.is_none())
+		throw std::invalid_argument("MarchingSquares: Give either a value range or a Lipschitz constant, not both");
+
+	if (value_range.is_none() && lipschitz.is_none())
+	{
+		if (!vectorized)
+			return std::make_shared<MarchingSquares>(function.cast<Function>(), x_limits, y_limits, resolution);
+
+		return std::make_shared<MarchingSquares>(VectorizedFunction(function), x_limits, y_limits, resolution);
+	}
+
+	BatchFunction sampled;
+	if (vectorized)
+		sampled = VectorizedFunction(function);
+	else
+	{
+		const auto point_function = function.cast<Function>();
+		sampled = [point_function](const double* xs, const double* ys, double* out, const size_t count)
+		{
+			for (size_t k = 0; k < count; ++k)
+				out[k] = point_function(xs[k], ys[k]);
+		};
+	}
+
+	// The Lipschitz bound evaluates the function at the center of every block
+	const auto center = [sampled](const double x, const double y)
+	{
+		double value;
+		sampled(&x, &y, &value, 1);
+
+		return value;
+	};
+
+	const auto range = lipschitz.is_none() ? value_range.cast<RangeFunction>() : LipschitzRange(center, lipschitz.cast<double>());
+
+	return std::make_shared<MarchingSquares>(sampled, range, x_limits, y_limits, resolution);
+}
+
+/**
+ * Creates a tiled contour from a python function, see VectorizedFunction
+ */
+std::shared_ptr<TiledContour> TiledFromFunction(const py::function& function,
+                                                const Limits& x_limits,
+                                                const Limits& y_limits,
+                                                const size_t tile_cells,
+                                                const size_t cache_bytes,
+                                                const bool vectorized)
+{
+	if (!vectorized)
+		return std::make_shared<TiledContour>(function.cast<Function>(), x_limits, y_limits, tile_cells, cache_bytes);
+
+	return std::make_shared<TiledContour>(VectorizedFunction(function), x_limits, y_limits, tile_cells, cache_bytes);
+}
+
+/**
+ * Points output buffers at writable numpy arrays of shape (n, 2)
+ *
+ * The arrays must already have the right dtype and layout, a converted
+ * copy would receive the contour instead of them
+ */
+OutputBuffers ToOutputBuffers(py::array_t<double, py::array::c_style>& vertices, py::array_t<uint32_t, py::array::c_style>& indices)
+{
+	if (vertices.ndim() != 2 || vertices.shape(1) != 2 || indices.ndim() != 2 || indices.shape(1) != 2)
+		throw std::invalid_argument("MarchingSquares: The output arrays must have the shape (n, 2)");
+
+	OutputBuffers buffers;
+	buffers.vertices = reinterpret_cast<Point2D*>(vertices.mutable_data());
+	buffers.vertex_capacity = static_cast<size_t>(vertices.shape(0));
+	buffers.indices = reinterpret_cast<EdgeVertices*>(indices.mutable_data());
+	buffers.index_capacity = static_cast<size_t>(indices.shape(0));
+
+	return buffers;
+}
+
+/**
+ * Exposes a buffer of a workspace to numpy without copying it
+ *
+ * The array keeps the workspace alive. Its content changes with the
+ * next computation using the workspace, so it is made read only
+ */
+template <typename T>
+py::array WorkspaceView(const std::vector<T>& values, const py::object& workspace)
+{
+	auto array = py::array(values.size(), values.data(), workspace);
+	array.attr("flags").attr("writeable") = false;
+
+	return array;
+}
+
+/**
+ * A background computation seen from python
+ *
+ * When the job finishes, its result is converted to numpy arrays and handed
+ * to a concurrent.futures.Future, so it can be waited for with a timeout,
+ * chained with callbacks or awaited with asyncio. Cancelling the future
+ * cancels the job as well
+ */
+template <typename Job>
+struct PyComputeJob
+{
+	Job job;
+	std::shared_ptr<const py::object> future;
+};
+
+/**
+ * Connects a job to a new future, must be called with the GIL held
+ *
+ * @param job The job to watch
+ * @param owner The object computing, it is kept alive until the job is finished
+ * @param convert Turns the result of the job into a python object
+ */
+template <typename Job, typename Convert>
+PyComputeJob<Job> WatchJob(Job job, std::shared_ptr<const MarchingSquares> owner, Convert convert)
+{
+	const auto future = HoldWithGil(py::module::import("concurrent.futures").attr("Future")());
+
+	future->attr("add_done_callback")(py::cpp_function([job](const py::object& future)
+	{
+		if (future.attr("cancelled")().cast<bool>())
+		{
+			auto target = job;
+			target.cancel();
+		}
+	}));
+
+	job.on_done([job, owner, future, convert]()
+	{
+		py::gil_scoped_acquire gil;
+
+		if (job.cancelled())
+		{
+			future->attr("cancel")();
+			return;
+		}
+		if (!future->attr("set_running_or_notify_cancel")().cast<bool>())
+			return;
+
+		// Calling through python translates the exceptions like any bound function
+		auto target = job;
+		const auto fetch = py::cpp_function([&target, &convert]() { return convert(target.get()); });
+
+		try
+		{
+			future->attr("set_result")(fetch());
+		}
+		catch (py::error_already_set& error)
+		{
+			future->attr("set_exception")(error.value());
+		}
+	});
+
+	return { std::move(job), future };
+}
+
+/**
+ * Exposes a job type to python
+ */
+template <typename Job>
+void BindComputeJob(py::module& m, const char* name)
+{
+	py::class_<PyComputeJob<Job>>(m, name,
+		"A computation running in the background. It can be awaited, or waited for with result()")
+	.def("done", [](const PyComputeJob<Job>& self) { return self.future->attr("done")(); })
+	.def("cancel", [](PyComputeJob<Job>& self) { self.job.cancel(); },
+	     "Stop the sweep at the next major axis column, the result then raises CancelledError")
+	.def("cancelled", [](const PyComputeJob<Job>& self) { return self.future->attr("cancelled")(); })
+	.def("result", [](const PyComputeJob<Job>& self, const py::object& timeout) { return self.future->attr("result")(timeout); },
+	     py::arg("timeout") = py::none(), "Wait for the result, the GIL is released meanwhile")
+	.def_property_readonly("columns_done", [](const PyComputeJob<Job>& self) { return self.job.columns_done(); })
+	.def_property_readonly("total_columns", [](const PyComputeJob<Job>& self) { return self.job.total_columns(); })
+	.def_property_readonly("progress", [](const PyComputeJob<Job>& self) { return self.job.progress(); },
+	                       "The share of the major axis columns swept so far, between 0 and 1")
+	.def_property_readonly("future", [](const PyComputeJob<Job>& self) { return *self.future; },
+	                       "The concurrent.futures.Future receiving the result")
+	.def("__await__", [](const PyComputeJob<Job>& self)
+	{
+		return py::module::import("asyncio").attr("wrap_future")(*self.future).attr("__await__")();
+	})
+	;
+}
+
+/**
+ * Exposes a buffer of a tile to numpy without copying it
+ *
+ * The array keeps the tile alive, even after it left the cache. Tiles are
+ * shared by every request that finds them in the cache, so the array is
+ * made read only
+ */
+template <typename T>
+py::array TileView(const std::vector<T>& values, const std::shared_ptr<const ContourTile>& tile)
+{
+	const auto capsule = py::capsule(new std::shared_ptr<const ContourTile>(tile), [](void* tile)
+	{
+		delete reinterpret_cast<std::shared_ptr<const ContourTile>*>(tile);
+	});
+
+	auto array = py::array(values.size(), values.data(), capsule);
+	array.attr("flags").attr("writeable") = false;
+
+	return array;
+}
+
+/**
+ * Parses the format and precision names of the mesh writers
+ */
+std::tuple<MeshFormat, MeshPrecision> MeshOptions(const std::string& format, const std::string& precision)
+{
+	if (format != "binary" && format != "ply")
+		throw std::invalid_argument("MeshWriter: The format must be binary or ply");
+	if (precision != "float64" && precision != "float32")
+		throw std::invalid_argument("MeshWriter: The precision must be float64 or float32");
+
+	return std::make_tuple(format == "ply" ? MeshFormat::Ply : MeshFormat::Binary,
+	                       precision == "float32" ? MeshPrecision::Float32 : MeshPrecision::Float64);
+}
+
 PYBIND11_MODULE(pymarchingCubes, m )
 {
     m.doc( ) = "Module that implements marching cubes and marching squares";
 
-	m.def("compute_faster_wrapper", [](const marching_squares::MarchingSquares& obj, const double iso_value) ->std::tuple<py::array, py::array>
+	m.def("compute_faster_wrapper", [](const marching_squares::MarchingSquares& obj, const double iso_value, const std::string& precision) ->std::tuple<py::array, py::array>
 	{
-		auto result = obj.compute_faster(iso_value);
+		if (precision != "float64" && precision != "float32" && precision != "uint16")
+			throw std::invalid_argument("compute_faster_wrapper: The precision must be float64, float32 or uint16");
 
-		// We grab the arrays from the tuple
-		auto vertices = new VerticesList{ std::move( std::get<0>(result) ) };
-		auto indices = new IndicesList{ std::move(std::get<1>(result)) };
+		// The strips may call back into python from worker threads, so the GIL must be free
+		py::array vertices;
+		IndicesList indices;
 
-		// Create py::capsules to keep the object alive in python
-		const auto v_capsule = py::capsule(vertices, [](void* vertices) { delete reinterpret_cast<VerticesList*>(vertices); });
-		const auto i_capsule = py::capsule(indices, [](void* indices) { delete reinterpret_cast<IndicesList*>(indices); });
+		if (precision == "float32")
+		{
+			std::tuple<VerticesListF, IndicesList> result;
+			{
+				py::gil_scoped_release release;
+				result = obj.compute_faster_float(iso_value);
+			}
+			vertices = ToArray(std::move(std::get<0>(result)));
+			indices = std::move(std::get<1>(result));
+		}
+		else if (precision == "uint16")
+		{
+			std::tuple<QuantizedVerticesList, IndicesList> result;
+			{
+				py::gil_scoped_release release;
+				result = obj.compute_faster_quantized(iso_value);
+			}
+			vertices = ToArray(std::move(std::get<0>(result)));
+			indices = std::move(std::get<1>(result));
+		}
+		else
+		{
+			std::tuple<VerticesList, IndicesList> result;
+			{
+				py::gil_scoped_release release;
+				result = obj.compute_faster(iso_value);
+			}
+			vertices = ToArray(std::move(std::get<0>(result)));
+			indices = std::move(std::get<1>(result));
+		}
 
 		// Return it as a tuple
-		return { py::array(vertices->size(), vertices->data(), v_capsule),
-		         py::array(indices->size(), indices->data(), i_capsule) };
+		return { vertices, ToArray(std::move(indices)) };
+
+	}, py::arg("obj"), py::arg("iso_value"), py::arg("precision") = "float64",
+	   "Compute result and transfer ownership to python without copying (when vectors are big, copying is expensive). "
+	   "With precision float32 the vertices are single precision, with uint16 every coordinate q stands for "
+	   "lower + q * (upper - lower) / 65535 of its limits")
+	;
+
+	m.def("compute_levels_wrapper", [](const marching_squares::MarchingSquares& obj, const std::vector<double>& iso_values) ->std::tuple<py::array, py::array, py::array>
+	{
+		std::tuple<VerticesList, IndicesList, OffsetTable> result;
+		{
+			py::gil_scoped_release release;
+			result = obj.compute_levels(iso_values);
+		}
+
+		return { ToArray(std::move(std::get<0>(result))),
+		         ToArray(std::move(std::get<1>(result))),
+		         ToArray(std::move(std::get<2>(result))) };
+
+	}, "Compute all the levels in one sweep. Level l uses vertices[offsets[l][0]:offsets[l + 1][0]] and indices[offsets[l][1]:offsets[l + 1][1]]")
+	;
+
+	m.def("compute_polylines_wrapper", [](const marching_squares::MarchingSquares& obj, const double iso_value) ->std::tuple<py::array, py::array, py::array, py::array>
+	{
+		std::tuple<VerticesList, Polylines> result;
+		{
+			py::gil_scoped_release release;
+			result = obj.compute_polylines(iso_value);
+		}
+
+		auto& polylines = std::get<1>(result);
+
+		return { ToArray(std::move(std::get<0>(result))),
+		         ToArray(std::move(polylines.indices)),
+		         ToArray(std::move(polylines.offsets)),
+		         ToArray(std::move(polylines.closed)) };
+
+	}, "Compute the contour as polylines. Polyline p is vertices[indices[offsets[p]:offsets[p + 1]]], closed loops repeat their first vertex")
+	;
+
+	m.def("assemble_polylines", [](const IndicesList& segments, const size_t vertex_count) ->std::tuple<py::array, py::array, py::array>
+	{
+		Polylines polylines;
+		{
+			py::gil_scoped_release release;
+			polylines = AssemblePolylines(segments, vertex_count);
+		}
+
+		return { ToArray(std::move(polylines.indices)),
+		         ToArray(std::move(polylines.offsets)),
+		         ToArray(std::move(polylines.closed)) };
+
+	}, py::arg("indices"), py::arg("vertex_count"), "Chain the segments of a contour into polylines, returns the indices, offsets and closed flags")
+	;
+
+	m.def("compute_streaming_wrapper", [](const marching_squares::MarchingSquares& obj,
+	                                      const double iso_value,
+	                                      const size_t chunk_columns,
+	                                      const py::function& sink,
+	                                      const bool local_indices)
+	{
+		py::gil_scoped_release release;
+
+		obj.compute_streaming(iso_value, chunk_columns, [&sink](ContourChunk& chunk)
+		{
+			// The buffers are moved out, so every chunk owns its arrays
+			py::gil_scoped_acquire gil;
+
+			sink(ToArray(std::move(chunk.vertices)),
+			     ToArray(std::move(chunk.indices)),
+			     chunk.vertex_offset,
+			     chunk.first_column,
+			     chunk.last_column);
+		}, local_indices ? ChunkIndexing::Local : ChunkIndexing::Global);
+
+	}, py::arg("obj"), py::arg("iso_value"), py::arg("chunk_columns"), py::arg("sink"), py::arg("local_indices") = false,
+	   "Compute the contour in chunks of major axis columns, calling sink(vertices, indices, vertex_offset, first_column, last_column) "
+	   "for each of them. Only one chunk is held in memory at a time")
+	;
+
+	m.def("write_mesh", [](const std::string& path,
+	                       const py::array_t<double, py::array::c_style | py::array::forcecast>& vertices,
+	                       const py::array_t<uint32_t, py::array::c_style | py::array::forcecast>& indices,
+	                       const std::string& format,
+	                       const std::string& precision)
+	{
+		if (vertices.size() % 2 != 0 || indices.size() % 2 != 0)
+			throw std::invalid_argument("write_mesh: The vertices and indices must hold pairs");
+
+		const auto options = MeshOptions(format, precision);
+
+		// The arrays are written straight from their memory, the GIL is not needed for that
+		py::gil_scoped_release release;
+
+		MeshWriter writer(path, std::get<0>(options), std::get<1>(options));
+		writer.append(reinterpret_cast<const Point2D*>(vertices.data()), static_cast<size_t>(vertices.size() / 2),
+		              reinterpret_cast<const EdgeVertices*>(indices.data()), static_cast<size_t>(indices.size() / 2));
+		writer.finish();
+
+	}, py::arg("path"), py::arg("vertices"), py::arg("indices"), py::arg("format") = "binary", py::arg("precision") = "float64",
+	   "Write a contour to a binary MSMESH2D file or a binary PLY file with an edge element")
+	;
+
+	m.def("read_mesh", [](const std::string& path) ->std::tuple<py::array, py::array>
+	{
+		std::tuple<VerticesList, IndicesList> result;
+		{
+			py::gil_scoped_release release;
+			result = ReadMesh(path);
+		}
+
+		return { ToArray(std::move(std::get<0>(result))), ToArray(std::move(std::get<1>(result))) };
+
+	}, py::arg("path"), "Read a contour written in the binary MSMESH2D format")
+	;
+
+	m.def("write_contour", [](const marching_squares::MarchingSquares& obj,
+	                          const double iso_value,
+	                          const std::string& path,
+	                          const std::string& format,
+	                          const std::string& precision,
+	                          const size_t chunk_columns)
+	{
+		const auto options = MeshOptions(format, precision);
+
+		py::gil_scoped_release release;
+
+		MeshWriter writer(path, std::get<0>(options), std::get<1>(options));
+
+		if (chunk_columns == 0)
+		{
+			const auto result = obj.compute_faster(iso_value);
+			writer.append(std::get<0>(result), std::get<1>(result));
+		}
+		else
+			obj.compute_streaming(iso_value, chunk_columns, [&writer](ContourChunk& chunk) { writer.append(chunk, ChunkIndexing::Global); });
+
+		writer.finish();
 
-	}, "Compute result and transfer ownership to python without copying (when vectors are big, copying is expensive)")
+		return writer.vertex_count();
+
+	}, py::arg("obj"), py::arg("iso_value"), py::arg("path"), py::arg("format") = "binary", py::arg("precision") = "float64",
+	   py::arg("chunk_columns") = 0,
+	   "Compute the contour and write it to a file without passing it through python, returns the number of vertices. "
+	   "With chunk_columns the contour is streamed, so only one chunk is held in memory")
+	;
+
+	py::class_<MarchingCubes, std::shared_ptr<MarchingCubes>>(m, "MarchingCubes",
+		"Isosurfaces of 3D scalar fields as indexed triangle meshes")
+	.def(py::init<Function3D, const Limits&, const Limits&, const Limits&, const Resolution3D&>(),
+	     py::arg("function"), py::arg("x_limits"), py::arg("y_limits"), py::arg("z_limits"), py::arg("resolution"))
+	.def(py::init(&VolumeFromArray<double>), py::arg("values"), py::arg("x_limits"), py::arg("y_limits"), py::arg("z_limits"),
+	     "Use an already sampled 3D array, indexed as values[z, y, x], in place of a function")
+	.def(py::init(&VolumeFromArray<float>), py::arg("values"), py::arg("x_limits"), py::arg("y_limits"), py::arg("z_limits"))
+	.def("compute", [](const MarchingCubes& self, const double iso_value) ->std::tuple<py::array, py::array>
+	{
+		std::tuple<VerticesList3D, TrianglesList> result;
+		{
+			py::gil_scoped_release release;
+			result = self.compute(iso_value);
+		}
+
+		return { ToArray(std::move(std::get<0>(result))), ToArray(std::move(std::get<1>(result))) };
+
+	}, py::arg("iso_value"),
+	   "Compute the isosurface, returns the vertices and the triangles as indices into them. "
+	   "Triangles are counterclockwise seen from the side below the iso value")
+	.def_property("thread_count", &MarchingCubes::thread_count, &MarchingCubes::set_thread_count,
+	              "Number of threads used by compute, setting it to 0 uses all hardware threads")
+	;
+
+	py::class_<TiledContour, std::shared_ptr<TiledContour>>(m, "TiledContour",
+		"Contours over a pyramid of tiles for viewers that pan and zoom, recently used tiles are cached. "
+		"Level 0 is one tile covering the limits, every level has twice the detail of the one before")
+	.def(py::init<const std::string&, const Limits&, const Limits&, size_t, size_t>(),
+	     py::arg("expression"), py::arg("x_limits"), py::arg("y_limits"), py::arg("tile_cells") = 64, py::arg("cache_bytes") = 64 << 20)
+	.def(py::init(&TiledFromFunction), py::arg("function"), py::arg("x_limits"), py::arg("y_limits"),
+	     py::arg("tile_cells") = 64, py::arg("cache_bytes") = 64 << 20, py::arg("vectorized") = false)
+	.def("tiles", [](TiledContour& self, const double iso_value, const Limits& x_view, const Limits& y_view, const uint32_t level)
+	{
+		std::vector<std::shared_ptr<const ContourTile>> tiles;
+		{
+			py::gil_scoped_release release;
+			tiles = self.tiles(iso_value, x_view, y_view, level);
+		}
+
+		py::list result;
+		for (const auto& tile : tiles)
+		{
+			result.append(py::make_tuple(py::make_tuple(tile->key.level, tile->key.x, tile->key.y),
+			                             TileView(tile->vertices, tile),
+			                             TileView(tile->indices, tile)));
+		}
+
+		return result;
+
+	}, py::arg("iso_value"), py::arg("x_view"), py::arg("y_view"), py::arg("level"),
+	   "The tiles of a level covering the view, as ((level, x, y), vertices, indices). Only the ones not cached are computed")
+	.def("level_for", &TiledContour::level_for, py::arg("x_view"), py::arg("y_view"), py::arg("pixels"),
+	     "The coarsest level with cells no bigger than a pixel of a view of the given size in pixels")
+	.def_property("cache_limit", &TiledContour::cache_limit, &TiledContour::set_cache_limit, "The most memory the cached tiles may take, in bytes")
+	.def_property_readonly("cached_bytes", &TiledContour::cached_bytes)
+	.def_property_readonly("cached_tiles", &TiledContour::cached_tiles)
+	.def_property_readonly("tiles_computed", &TiledContour::tiles_computed)
+	.def("clear_cache", &TiledContour::clear_cache)
+	.def_property("thread_count", &TiledContour::thread_count, &TiledContour::set_thread_count,
+	              "Number of tiles computed at the same time, setting it to 0 uses all hardware threads")
+	;
+
+	m.attr("stats_enabled") = StatsEnabled();
+
+	py::class_<ComputeStats>(m, "ComputeStats",
+		"Counters of a computation, all zero unless the library was built with MARCHING_SQUARES_STATS. Times are summed over the threads")
+	.def_readonly("node_evaluations", &ComputeStats::node_evaluations)
+	.def_readonly("crossing_edges", &ComputeStats::crossing_edges)
+	.def_readonly("ambiguous_cells", &ComputeStats::ambiguous_cells)
+	.def_readonly("sample_seconds", &ComputeStats::sample_seconds)
+	.def_readonly("sweep_seconds", &ComputeStats::sweep_seconds)
+	.def_readonly("stitch_seconds", &ComputeStats::stitch_seconds)
+	.def_readonly("bytes_allocated", &ComputeStats::bytes_allocated)
+	.def_readonly("reallocations", &ComputeStats::reallocations)
+	;
+
+	py::class_<EdgeListView>(m, "EdgeListView",
+		"The segments of a contour, every segment is expanded to ((x0, y0), (x1, y1)) when it is read")
+	.def("__len__", &EdgeListView::size)
+	.def("__getitem__", [](const EdgeListView& self, py::ssize_t index)
+	{
+		const auto size = static_cast<py::ssize_t>(self.size());
+		if (index < 0)
+			index += size;
+		if (index < 0 || index >= size)
+			throw py::index_error();
+
+		return self[static_cast<size_t>(index)];
+	})
+	.def("__iter__", [](const EdgeListView& self) { return py::make_iterator(self.begin(), self.end()); }, py::keep_alive<0, 1>())
+	.def_property_readonly("vertices", [](const py::object& self) { return WorkspaceView(self.cast<const EdgeListView&>().vertices(), self); })
+	.def_property_readonly("indices", [](const py::object& self) { return WorkspaceView(self.cast<const EdgeListView&>().indices(), self); })
+	.def("to_list", &EdgeListView::to_edge_list, "Expand all the segments at once, like compute")
+	;
+
+	BindComputeJob<ContourJob>(m, "ContourJob");
+	BindComputeJob<LevelsJob>(m, "LevelsJob");
+
+	py::class_<OutputStatus>(m, "OutputStatus",
+		"What compute_into wrote to the start of the arrays, and what is left for write_remaining")
+	.def_readonly("vertices_written", &OutputStatus::vertices_written)
+	.def_readonly("indices_written", &OutputStatus::indices_written)
+	.def_readonly("vertices_remaining", &OutputStatus::vertices_remaining)
+	.def_readonly("indices_remaining", &OutputStatus::indices_remaining)
+	.def_property_readonly("complete", &OutputStatus::complete)
+	;
+
+	py::class_<Workspace>(m, "Workspace",
+		"Reusable buffers for compute_faster and compute_levels. The results are views that change with the next call")
+	.def(py::init<>())
+	.def_property_readonly("vertices", [](const py::object& self) { return WorkspaceView(self.cast<const Workspace&>().vertices(), self); })
+	.def_property_readonly("indices", [](const py::object& self) { return WorkspaceView(self.cast<const Workspace&>().indices(), self); })
+	.def_property_readonly("offsets", [](const py::object& self) { return WorkspaceView(self.cast<const Workspace&>().offsets(), self); })
+	.def_property_readonly("stats", [](const Workspace& self) { return self.stats(); }, "A copy of the counters of the last computation")
 	;
 
 	py::class_<MarchingSquares, std::shared_ptr<MarchingSquares>>(m, "MarchingSquares")
 	.def(py::init<Function, const Limits&, const Limits&, const Resolution&> ())
-	.def("compute", &MarchingSquares::compute)
-	.def("compute_faster", &MarchingSquares::compute_faster, py::call_guard<py::gil_scoped_release>())
+	.def(py::init(&FromFunction), py::arg("function"), py::arg("x_limits"), py::arg("y_limits"), py::arg("resolution"), py::arg("vectorized"),
+	     py::arg("value_range") = py::none(), py::arg("lipschitz") = py::none(),
+	     "With vectorized=True, the function is called once per column as f(xs, ys) with numpy arrays. "
+	     "value_range(x_range, y_range) returning (lower, upper) bounds over a rectangle, or a Lipschitz constant, "
+	     "lets the sweep skip the blocks the contour can not pass through. The bounds are trusted")
+	.def(py::init<const std::string&, const Limits&, const Limits&, const Resolution&>(),
+	     py::arg("expression"), py::arg("x_limits"), py::arg("y_limits"), py::arg("resolution"),
+	     "Compile a function of x and y given as text, like \"sin(x**2 + y**2) - cos(x*y)\". "
+	     "It is evaluated natively, so python is not called and the GIL stays released")
+	.def(py::init(&FromArray<double>), py::arg("values"), py::arg("x_limits"), py::arg("y_limits"),
+	     "Use an already sampled 2D array (rows along y, columns along x) in place of a function")
+	.def(py::init(&FromArray<float>), py::arg("values"), py::arg("x_limits"), py::arg("y_limits"))
+	.def_static("from_raster_file", &FromRasterFile, py::arg("path"), py::arg("x_limits"), py::arg("y_limits"),
+	            "Memory map a raster file with a header, it is read row by row and may be larger than the memory")
+	.def_static("from_raw_raster_file", &FromRawRasterFile, py::arg("path"), py::arg("dtype"), py::arg("rows"), py::arg("columns"),
+	            py::arg("x_limits"), py::arg("y_limits"), py::arg("offset") = 0,
+	            "Memory map a headerless row-major float32 or float64 raster file")
+	.def("compute", &MarchingSquares::compute, py::call_guard<py::gil_scoped_release>())
+	.def("compute_view", &MarchingSquares::compute_view, py::call_guard<py::gil_scoped_release>(),
+	     "Like compute, but the segments are only expanded to coordinates when they are read")
+	.def("compute_faster", py::overload_cast<double>(&MarchingSquares::compute_faster, py::const_), py::call_guard<py::gil_scoped_release>())
+	.def("compute_faster", py::overload_cast<double, Workspace&>(&MarchingSquares::compute_faster, py::const_), py::call_guard<py::gil_scoped_release>())
+	.def("estimate_output", [](const MarchingSquares& self, const double iso_value)
+	{
+		const auto bounds = self.estimate_output(iso_value);
+		return py::make_tuple(bounds.vertices, bounds.indices);
+	}, py::arg("iso_value"), "The most vertices and indices the contour can have, without sampling the field")
+	.def("compute_into", [](const MarchingSquares& self, const double iso_value, Workspace& workspace,
+	                        py::array_t<double, py::array::c_style> vertices, py::array_t<uint32_t, py::array::c_style> indices)
+	{
+		const auto buffers = ToOutputBuffers(vertices, indices);
+
+		py::gil_scoped_release release;
+		return self.compute_into(iso_value, workspace, buffers);
+
+	}, py::arg("iso_value"), py::arg("workspace"), py::arg("vertices").noconvert(), py::arg("indices").noconvert(),
+	   "Compute the contour into preallocated float64 (n, 2) and uint32 (m, 2) arrays, as much as fits. "
+	   "The rest stays in the workspace for write_remaining")
+	.def("compute_levels_into", [](const MarchingSquares& self, const std::vector<double>& iso_values, Workspace& workspace,
+	                               py::array_t<double, py::array::c_style> vertices, py::array_t<uint32_t, py::array::c_style> indices)
+	{
+		const auto buffers = ToOutputBuffers(vertices, indices);
+
+		py::gil_scoped_release release;
+		return self.compute_levels_into(iso_values, workspace, buffers);
+
+	}, py::arg("iso_values"), py::arg("workspace"), py::arg("vertices").noconvert(), py::arg("indices").noconvert(),
+	   "Like compute_into for several levels, the offsets of the workspace tell where each level starts")
+	.def("write_remaining", [](const MarchingSquares& self, Workspace& workspace,
+	                           py::array_t<double, py::array::c_style> vertices, py::array_t<uint32_t, py::array::c_style> indices)
+	{
+		const auto buffers = ToOutputBuffers(vertices, indices);
+
+		py::gil_scoped_release release;
+		return self.write_remaining(workspace, buffers);
+
+	}, py::arg("workspace"), py::arg("vertices").noconvert(), py::arg("indices").noconvert(),
+	   "Continue a compute_into that did not fit, from the start of the arrays. Indices count from the first vertex of the whole contour")
+	.def("compute_faster_float", &MarchingSquares::compute_faster_float, py::call_guard<py::gil_scoped_release>())
+	.def("compute_faster_quantized", &MarchingSquares::compute_faster_quantized, py::call_guard<py::gil_scoped_release>())
+	.def("compute_adaptive", &MarchingSquares::compute_adaptive, py::arg("iso_value"), py::arg("coarse_step"), py::arg("tolerance") = 0.0,
+	     py::call_guard<py::gil_scoped_release>(),
+	     "Sample every coarse_step cells and only refine the blocks the contour may cross")
+	.def("compute_levels", py::overload_cast<const std::vector<double>&>(&MarchingSquares::compute_levels, py::const_), py::call_guard<py::gil_scoped_release>())
+	.def("compute_levels", py::overload_cast<const std::vector<double>&, Workspace&>(&MarchingSquares::compute_levels, py::const_), py::call_guard<py::gil_scoped_release>())
+	.def("compute_chunked", [](const MarchingSquares& self, const double iso_value, const size_t max_chunk_vertices)
+	{
+		std::vector<ContourChunk> chunks;
+		{
+			py::gil_scoped_release release;
+			chunks = self.compute_chunked(iso_value, max_chunk_vertices);
+		}
+
+		py::list result;
+		for (auto& chunk : chunks)
+			result.append(py::make_tuple(chunk.vertex_offset, ToArray(std::move(chunk.vertices)), ToArray(std::move(chunk.indices))));
+
+		return result;
+
+	}, py::arg("iso_value"), py::arg("max_chunk_vertices") = MaxIndexedVertices,
+	   "Compute the contour as chunks of (vertex_offset, vertices, indices) with uint32 indices local to every chunk, "
+	   "for contours with more vertices than 32 bit indices can address")
+	.def("compute_tracked", [](const MarchingSquares& self, const double iso_value,
+	                           const py::array_t<uint64_t, py::array::c_style | py::array::forcecast>& previous_cells,
+	                           const size_t band, const double max_band_fraction)
+	{
+		const CellList cells(previous_cells.data(), previous_cells.data() + previous_cells.size());
+
+		TrackedContour tracked;
+		{
+			py::gil_scoped_release release;
+			tracked = self.compute_tracked(iso_value, cells, band, max_band_fraction);
+		}
+
+		return py::make_tuple(ToArray(std::move(tracked.vertices)),
+		                      ToArray(std::move(tracked.indices)),
+		                      ToArray(std::move(tracked.active_cells)),
+		                      tracked.full_sweep);
+
+	}, py::arg("iso_value"), py::arg("previous_cells"), py::arg("band") = 1, py::arg("max_band_fraction") = 0.25,
+	   "Follow a contour from the active cells of the previous time step, returns the vertices, indices, active cells "
+	   "and whether the whole grid was swept. Only the cells within band of the previous ones are checked, unless there "
+	   "are none or the contour takes more than max_band_fraction of the cells")
+	.def("active_cells", [](const MarchingSquares& self, const VerticesList& vertices, const IndicesList& indices)
+	{
+		return ToArray(self.active_cells(vertices, indices));
+	}, py::arg("vertices"), py::arg("indices"),
+	   "The cells a contour computed on this grid passes through, as iy * resolution[0] + ix, to start compute_tracked from")
+	.def("compute_faster_async", [](const std::shared_ptr<MarchingSquares>& self, const double iso_value)
+	{
+		return WatchJob(self->compute_faster_async(iso_value), self, [](std::tuple<VerticesList, IndicesList>&& result)
+		{
+			return py::make_tuple(ToArray(std::move(std::get<0>(result))), ToArray(std::move(std::get<1>(result))));
+		});
+	}, py::arg("iso_value"), "Start compute_faster in the background, the job resolves to the vertices and indices as arrays")
+	.def("compute_levels_async", [](const std::shared_ptr<MarchingSquares>& self, const std::vector<double>& iso_values)
+	{
+		return WatchJob(self->compute_levels_async(iso_values), self, [](std::tuple<VerticesList, IndicesList, OffsetTable>&& result)
+		{
+			return py::make_tuple(ToArray(std::move(std::get<0>(result))),
+			                      ToArray(std::move(std::get<1>(result))),
+			                      ToArray(std::move(std::get<2>(result))));
+		});
+	}, py::arg("iso_values"), "Start compute_levels in the background, the job resolves to the vertices, indices and offsets as arrays")
+	.def_property("thread_count", &MarchingSquares::thread_count, &MarchingSquares::set_thread_count,
+	              "Number of threads used by compute_faster, setting it to 0 uses all hardware threads")
+	.def_property("field_caching", &MarchingSquares::field_caching,
+	              py::cpp_function(&MarchingSquares::set_field_caching, py::call_guard<py::gil_scoped_release>()),
+	              "Keep the sampled field, so later iso values only sweep the tiles they pass through. Enabling it samples the grid")
 	;
 }
@@ -1,16 +1,16 @@
-from pymarchingCubes import MarchingSquares, compute_faster_wrapper
+from pymarchingCubes import MarchingSquares
 import matplotlib.pyplot as plt
-from math import cos, sin, exp
 from numpy import linspace
+import time
 
 
-def func(x,y):
-    # return sin(5 * x) * cos(5 * y)/5
-    # return sin(0.1 * x * x + 0.2 * y * y)
-    # return (1-(x**2+y**3))*exp(-(x**2+y**2)/2)
-    # return exp(sin(x) + cos(y)) -sin(exp(x+y))
-    # return sin(sin(x) + cos(y)) - cos(sin(x*y) + cos(x))
-    return sin(x**2 + y**2) - cos(x*y)
+# The function is compiled from text and runs without calling back into python
+# func = "sin(5 * x) * cos(5 * y)/5"
+# func = "sin(0.1 * x * x + 0.2 * y * y)"
+# func = "(1-(x**2+y**3))*exp(-(x**2+y**2)/2)"
+# func = "exp(sin(x) + cos(y)) -sin(exp(x+y))"
+# func = "sin(sin(x) + cos(y)) - cos(sin(x*y) + cos(x))"
+func = "sin(x**2 + y**2) - cos(x*y)"
 
 ms = MarchingSquares(func, [-10, 10], [-10,10], [250,250])
 
@@ -18,11 +18,17 @@ ms = MarchingSquares(func, [-10, 10], [-10,10], [250,250])
 
 levels = [0.5]
 
-for lvl in levels:
-    vertices, indices = compute_faster_wrapper(ms, lvl)
-    print("Done computing result")
-    
-    for edge in indices:
+# All the levels are computed in a single sweep, in the background
+job = ms.compute_levels_async(levels)
+while not job.done():
+    print("Computing: {:.0%}".format(job.progress))
+    time.sleep(0.1)
+
+vertices, indices, offsets = job.result()
+print("Done computing result")
+
+for lvl in range(len(levels)):
+    for edge in indices[offsets[lvl][1]:offsets[lvl + 1][1]]:
         plt.plot([vertices[edge[0]][0], vertices[edge[1]][0]], [vertices[edge[0]][1], vertices[edge[1]][1]], 'r')
 
 plt.axis('equal')
@@ -19,7 +19,8 @@ ms = MarchingSquares(func, [-10, 10], [-10,10], [250,250])
 levels = [0.5]
 
 for lvl in levels:
-    result = ms.compute(lvl)
+    # The segments are expanded to coordinates one at a time while plotting
+    result = ms.compute_view(lvl)
     print("Done computing result")
     
     for edge in result:
@@ -1,5 +1,4 @@
-from pymarchingCubes import MarchingSquares, compute_faster_wrapper
-from math import cos, sin
+from pymarchingCubes import TiledContour
 
 import glfw
 from OpenGL.GL import *
@@ -7,23 +6,25 @@ from OpenGL.GL.shaders import compileShader, compileProgram
 import numpy as np
 
 
-def func(x,y):
-    # return sin(5 * x) * cos(5 * y)/5
-    # return sin(0.1 * x * x + 0.2 * y * y)
-    # return (1-(x**2+y**3))*exp(-(x**2+y**2)/2)
-    # return exp(sin(x) + cos(y)) -sin(exp(x+y))
-    # return sin(sin(10*x) + cos(10*y)) - cos(sin(100*x*y) + cos(10*x))
-    return sin(100*x**2 + 100*y**2) - cos(100*x*y)
+# func = "sin(5 * x) * cos(5 * y)/5"
+# func = "sin(0.1 * x * x + 0.2 * y * y)"
+# func = "(1-(x**2+y**3))*exp(-(x**2+y**2)/2)"
+# func = "exp(sin(x) + cos(y)) -sin(exp(x+y))"
+# func = "sin(sin(10*x) + cos(10*y)) - cos(sin(100*x*y) + cos(10*x))"
+func = "sin(100*x**2 + 100*y**2) - cos(100*x*y)"
 
 
 vertex_src = """
 # version 330 core
 
-layout (location = 0)in vec3 a_position;
+layout (location = 0)in vec2 a_position;
+
+// The vertices are relative to the center of the view, this is half its size
+uniform vec2 u_half_size;
 
 void main()
 {
-    gl_Position = vec4(a_position, 1.0);
+    gl_Position = vec4(a_position / u_half_size, 0.0, 1.0);
 }
 
 """
@@ -41,8 +42,30 @@ void main()
 """
 
 
-def window_resize(window, width, height):
-    glViewport(0, 0, width, height)
+class Camera():
+    """The rectangle of the plane shown in the window"""
+
+    def __init__(self, center=(0.0, 0.0), half_height=1.0):
+        self.center = list(center)
+        self.half_height = half_height
+        self.aspect = 1.0
+
+    def half_size(self):
+        return self.half_height * self.aspect, self.half_height
+
+    def view(self):
+        half_width, half_height = self.half_size()
+        return ([self.center[0] - half_width, self.center[0] + half_width],
+                [self.center[1] - half_height, self.center[1] + half_height])
+
+    def pan(self, dx, dy):
+        """Moves the view by a fraction of its size"""
+        half_width, half_height = self.half_size()
+        self.center[0] += 2 * dx * half_width
+        self.center[1] += 2 * dy * half_height
+
+    def zoom(self, factor):
+        self.half_height /= factor
 
 
 
@@ -66,53 +89,126 @@ class Window():
             raise Exception("The window could not be created")
 
         glfw.set_window_pos(self.window, self.x_pos, self.y_pos)
-        glfw.set_window_size_callback(self.window, window_resize)
         glfw.make_context_current(self.window)
 
         glClearColor(0, 0.1, 0.1, 0)
 
-        # OpenGL goes from -1 to 1, always
-        # TODO: Implement camera class to move around the scene  
-        ms = MarchingSquares(func, [-1, 1], [-1,1], [250, 250])
-
-        vertices, self.indices = compute_faster_wrapper(ms, 0.5)
+        # Tiles are contoured with about one cell per pixel and cached,
+        # so panning only computes the tiles coming into view
+        self.contour = TiledContour(func, [-1, 1], [-1, 1], tile_cells=64)
+        self.contour.thread_count = 0
+        self.camera = Camera()
+        self.drag = None
+        self.dirty = True
+        self.index_count = 0
 
-        # Flatten out the array
-        vertices = np.ravel(vertices)
-        
-        # Unfortunately, glDrawElements doesn't support uint64, so we made
-        # incides to be unit32_t in C++ instead pf size_t (uinit64_t) 
-        self.indices = np.ravel(self.indices)
-        print("Done computing results")
-
-        shader = compileProgram(compileShader(vertex_src, GL_VERTEX_SHADER),
-                                compileShader(fragment_src, GL_FRAGMENT_SHADER))
+        self.shader = compileProgram(compileShader(vertex_src, GL_VERTEX_SHADER),
+                                     compileShader(fragment_src, GL_FRAGMENT_SHADER))
+        self.half_size_location = glGetUniformLocation(self.shader, "u_half_size")
 
         # Vertex buffer
-        VBO = glGenBuffers(1)
-        glBindBuffer(GL_ARRAY_BUFFER, VBO)
-        glBufferData(GL_ARRAY_BUFFER, vertices.nbytes, vertices, GL_STATIC_DRAW)
+        self.VBO = glGenBuffers(1)
+        glBindBuffer(GL_ARRAY_BUFFER, self.VBO)
 
         # Element buffer
-        EBO = glGenBuffers(1)
-        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, EBO)
-        glBufferData(GL_ELEMENT_ARRAY_BUFFER, self.indices.nbytes, self.indices, GL_STATIC_DRAW)
+        self.EBO = glGenBuffers(1)
+        glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, self.EBO)
 
-        # i_position = glGetAttribLocation(shader, "a_position")
         glEnableVertexAttribArray(0)
-        glVertexAttribPointer(0, 2, GL_DOUBLE, GL_FALSE, 0, ctypes.c_void_p(0))
+        glVertexAttribPointer(0, 2, GL_FLOAT, GL_FALSE, 0, ctypes.c_void_p(0))
+
+        glUseProgram(self.shader)
+
+        glfw.set_framebuffer_size_callback(self.window, self.on_resize)
+        glfw.set_scroll_callback(self.window, self.on_scroll)
+        glfw.set_mouse_button_callback(self.window, self.on_mouse_button)
+        glfw.set_cursor_pos_callback(self.window, self.on_cursor)
+        glfw.set_key_callback(self.window, self.on_key)
+
+        self.on_resize(self.window, *glfw.get_framebuffer_size(self.window))
+
+
+    def on_resize(self, window, width, height):
+        glViewport(0, 0, width, height)
+        self.pixels = (max(width, 1), max(height, 1))
+        self.camera.aspect = self.pixels[0] / self.pixels[1]
+        self.dirty = True
+
+    def on_scroll(self, window, x_offset, y_offset):
+        self.camera.zoom(1.25 ** y_offset)
+        self.dirty = True
 
-        glUseProgram(shader)
-        glEnable(GL_DEPTH_TEST)
+    def on_mouse_button(self, window, button, action, mods):
+        if button == glfw.MOUSE_BUTTON_LEFT:
+            self.drag = glfw.get_cursor_pos(window) if action == glfw.PRESS else None
+
+    def on_cursor(self, window, x, y):
+        if self.drag is None:
+            return
+
+        width, height = glfw.get_window_size(window)
+        self.camera.pan((self.drag[0] - x) / max(width, 1), (y - self.drag[1]) / max(height, 1))
+        self.drag = (x, y)
+        self.dirty = True
+
+    def on_key(self, window, key, scancode, action, mods):
+        if action == glfw.RELEASE:
+            return
+
+        steps = {glfw.KEY_LEFT: (-0.1, 0), glfw.KEY_RIGHT: (0.1, 0), glfw.KEY_UP: (0, 0.1), glfw.KEY_DOWN: (0, -0.1)}
+        if key in steps:
+            self.camera.pan(*steps[key])
+            self.dirty = True
+        elif key in (glfw.KEY_EQUAL, glfw.KEY_KP_ADD):
+            self.camera.zoom(1.25)
+            self.dirty = True
+        elif key in (glfw.KEY_MINUS, glfw.KEY_KP_SUBTRACT):
+            self.camera.zoom(0.8)
+            self.dirty = True
+
+
+    def update_geometry(self):
+        """Fetches the tiles in view and uploads them as one batch of lines"""
+        x_view, y_view = self.camera.view()
+        level = self.contour.level_for(x_view, y_view, self.pixels)
+        tiles = self.contour.tiles(0.5, x_view, y_view, level)
+
+        vertices, indices, offset = [], [], 0
+        for key, tile_vertices, tile_indices in tiles:
+            vertices.append(tile_vertices)
+            indices.append(tile_indices + offset)
+            offset += len(tile_vertices)
+
+        if offset == 0:
+            self.index_count = 0
+            return
+
+        # Moved next to the origin in double precision first, so single precision still
+        # resolves the vertices when zoomed in far away from the origin
+        vertices = (np.concatenate(vertices) - self.camera.center).astype(np.float32)
+        indices = np.ravel(np.concatenate(indices)).astype(np.uint32)
+        self.index_count = len(indices)
+
+        glBufferData(GL_ARRAY_BUFFER, vertices.nbytes, vertices, GL_DYNAMIC_DRAW)
+        glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.nbytes, indices, GL_DYNAMIC_DRAW)
+        glUniform2f(self.half_size_location, *self.camera.half_size())
+
+        glfw.set_window_title(self.window, "{} - level {}, {} tiles, {} computed".format(
+            self.title, level, len(tiles), self.contour.tiles_computed))
 
 
     def run(self):
         while not glfw.window_should_close(self.window):
             glfw.poll_events()
+
+            if self.dirty:
+                self.update_geometry()
+                self.dirty = False
+
             glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT)
 
-            # glDrawArrays(GL_TRIANGLE_STRIP, 0, 4)
-            glDrawElements(GL_LINES, len(self.indices), GL_UNSIGNED_INT, ctypes.c_void_p(0))
+            if self.index_count > 0:
+                glDrawElements(GL_LINES, self.index_count, GL_UNSIGNED_INT, ctypes.c_void_p(0))
 
             glfw.swap_buffers(self.window)
 